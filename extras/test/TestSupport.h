@@ -0,0 +1,115 @@
+/*
+ * TestSupport.h
+ *
+ * Small helpers shared by the host tests.
+ *
+ * Created by Digital Futures OCAD U
+ * MIT License
+ */
+
+#ifndef DFPONG_TEST_SUPPORT_H
+#define DFPONG_TEST_SUPPORT_H
+
+#include <DFPongController.h>
+#include "MockBLE.h"
+
+#include <algorithm>
+#include <random>
+#include <stdio.h>
+#include <vector>
+
+static int testFailures = 0;
+
+#define EXPECT(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            testFailures++; \
+        } \
+    } while (0)
+
+// Fresh stack and clock for the next controller
+inline void resetStack(uint32_t seed) {
+    mock::reset();
+    mock::seed(seed);
+    mock::setTime(1000);
+    mock::clearSerial();
+}
+
+// Run loop() for a while: host task, then update()
+inline void runFor(DFPongController& controller, unsigned long ms, unsigned long step = 10) {
+    for (unsigned long t = 0; t < ms; t += step) {
+        mock::advance(step);
+        mock::hostStep();
+        controller.update();
+    }
+}
+
+inline unsigned long randomRange(std::mt19937& rng, unsigned long low, unsigned long high) {
+    return std::uniform_int_distribution<unsigned long>(low, high)(rng);
+}
+
+inline bool chance(std::mt19937& rng, double probability) {
+    return std::uniform_real_distribution<double>(0, 1)(rng) < probability;
+}
+
+// Parse a dumpTrace() capture (DFPT header + 8-byte records)
+inline std::vector<DFPongTraceEvent> parseTrace(const std::vector<uint8_t>& data, int* headerCount = nullptr) {
+    std::vector<DFPongTraceEvent> events;
+    if (data.size() < 8 || data[0] != 'D' || data[1] != 'F' || data[2] != 'P' || data[3] != 'T') {
+        return events;
+    }
+    if (headerCount != nullptr) *headerCount = data[6] | (data[7] << 8);
+
+    for (size_t i = 8; i + 8 <= data.size(); i += 8) {
+        DFPongTraceEvent e;
+        e.time = (uint32_t)data[i] | ((uint32_t)data[i + 1] << 8) |
+                 ((uint32_t)data[i + 2] << 16) | ((uint32_t)data[i + 3] << 24);
+        e.event = data[i + 4];
+        e.value = data[i + 5];
+        e.extra = (uint16_t)(data[i + 6] | (data[i + 7] << 8));
+        events.push_back(e);
+    }
+    return events;
+}
+
+// Read the trace back through dumpTrace() and the binary format
+inline std::vector<DFPongTraceEvent> readTrace(DFPongController& controller, int* headerCount = nullptr) {
+    mock::clearSerial();
+    controller.dumpTrace();
+    std::vector<DFPongTraceEvent> events = parseTrace(mock::serialOutput(), headerCount);
+    mock::clearSerial();
+    return events;
+}
+
+inline int countEvents(const std::vector<DFPongTraceEvent>& events, uint8_t code) {
+    int count = 0;
+    for (const DFPongTraceEvent& e : events) {
+        if (e.event == code) count++;
+    }
+    return count;
+}
+
+inline unsigned long percentile(std::vector<unsigned long> values, int p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t index = (values.size() - 1) * p / 100;
+    return values[index];
+}
+
+inline void printPercentiles(const char* name, const std::vector<unsigned long>& values) {
+    printf("%-20s n=%-6zu p50=%-6lu p90=%-6lu p99=%-6lu max=%lu\n", name, values.size(),
+           percentile(values, 50), percentile(values, 90), percentile(values, 99),
+           percentile(values, 100));
+}
+
+inline int finishTests(const char* name) {
+    if (testFailures == 0) {
+        printf("%s: all passed\n", name);
+        return 0;
+    }
+    printf("%s: %d failed\n", name, testFailures);
+    return 1;
+}
+
+#endif // DFPONG_TEST_SUPPORT_H
@@ -0,0 +1,328 @@
+/*
+ * churn_test.cpp
+ *
+ * Seeded connect/disconnect churn with loop stalls, failing
+ * notifications and games that write the handshake before they
+ * subscribe. After every update() the controller has to agree
+ * with what the centrals did, never stop advertising with a free
+ * slot and never count an invariant violation.
+ *
+ * Prints recovery and re-advertise latency percentiles at the end.
+ *
+ *   churn_test_<platform> [scenarios] [first seed]
+ *
+ * Created by Digital Futures OCAD U
+ * MIT License
+ */
+
+#include "TestSupport.h"
+
+#include <stdlib.h>
+
+#ifdef DFPONG_USE_NIMBLE
+#include <atomic>
+#include <chrono>
+#include <thread>
+#endif
+
+#ifdef DFPONG_USE_NIMBLE
+const int CENTRALS = 3;
+#else
+const int CENTRALS = 1;
+#endif
+
+const unsigned long SCENARIO_MS = 10000;
+
+// What a central does once connected
+enum Role { ROLE_GAME, ROLE_EARLY_GAME, ROLE_SPECTATOR, ROLE_SILENT };
+
+struct CentralModel {
+    bool connected;
+    bool subscribed;
+    bool handshakeSent;
+    Role role;
+    unsigned long subscribeAt;
+    unsigned long handshakeAt;
+};
+
+struct ChurnStats {
+    std::vector<unsigned long> recovery;
+    std::vector<unsigned long> readvertise;
+    int earlyHandshakesReady;  // Games that wrote the handshake before subscribing
+};
+
+// Stop a scenario at its first failure
+#define SCENARIO_EXPECT(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("FAIL seed %u at %lu ms: %s\n", seed, millis(), #condition); \
+            testFailures++; \
+            return; \
+        } \
+    } while (0)
+
+static Role randomRole(std::mt19937& rng) {
+#ifdef DFPONG_USE_NIMBLE
+    unsigned long pick = randomRange(rng, 0, 99);
+    if (pick < 35) return ROLE_GAME;
+    if (pick < 50) return ROLE_EARLY_GAME;
+    if (pick < 85) return ROLE_SPECTATOR;
+    return ROLE_SILENT;
+#else
+    unsigned long pick = randomRange(rng, 0, 99);
+    if (pick < 60) return ROLE_GAME;
+    if (pick < 90) return ROLE_EARLY_GAME;
+    return ROLE_SILENT;
+#endif
+}
+
+// ============================================
+// Virtual clock scenarios
+// ============================================
+
+static void runScenario(uint32_t seed, ChurnStats& stats) {
+    resetStack(seed);
+    std::mt19937 rng(seed);
+
+    DFPongController controller;
+    controller.setControllerNumber(1 + seed % 242);
+#ifdef DFPONG_USE_NIMBLE
+    controller.setMaxConnections(CENTRALS);
+#endif
+    SCENARIO_EXPECT(controller.begin());
+    mock::setNotifyFailRate(std::uniform_real_distribution<double>(0, 0.2)(rng));
+
+    CentralModel centrals[CENTRALS] = {};
+    int gameCentral = -1;
+    int gameCount = 0;
+    int lastGameCount = 0;
+    bool gameSubscribed = false;
+
+    int direction = NEUTRAL;
+    unsigned long directionSince = millis();
+    int updatesSinceChange = 0;
+
+    bool wasReady = false;
+    bool readyBefore = false;
+    unsigned long notAdvertisingStart = 0;
+    unsigned long notAdvertisingSince = 0;
+    int notAdvertisingUpdates = 0;
+
+    unsigned long end = millis() + SCENARIO_MS;
+    while (millis() < end) {
+        // Loop period, with the odd long stall
+        unsigned long period = chance(rng, 0.02) ? randomRange(rng, 100, 400) : randomRange(rng, 1, 20);
+        mock::advance(period);
+        unsigned long t = millis();
+
+        for (int i = 0; i < CENTRALS; i++) {
+            CentralModel& c = centrals[i];
+
+            // Dropped by the library (handshake timeout)
+            if (c.connected && !mock::isConnected(i)) {
+                c.connected = false;
+                if (gameCentral == i) gameCentral = -1;
+            }
+
+            if (!c.connected) {
+                if (chance(rng, 0.05) && mock::connect(i)) {
+                    c = CentralModel();
+                    c.connected = true;
+                    c.role = randomRole(rng);
+                    c.subscribeAt = t + randomRange(rng, 0, 100);
+                    c.handshakeAt = c.subscribeAt + randomRange(rng, 0, 300);
+                    if (c.role == ROLE_EARLY_GAME) {
+                        // Handshake written before subscribing
+                        c.handshakeAt = t + randomRange(rng, 0, 50);
+                        c.subscribeAt = c.handshakeAt + randomRange(rng, 1, 300);
+                    }
+                }
+                continue;
+            }
+
+            // Connections last about two seconds
+            if (chance(rng, period / 2000.0)) {
+                SCENARIO_EXPECT(mock::disconnect(i));
+                c.connected = false;
+                if (gameCentral == i) gameCentral = -1;
+                continue;
+            }
+
+            if (!c.subscribed && t >= c.subscribeAt) {
+                SCENARIO_EXPECT(mock::subscribe(i, true));
+                c.subscribed = true;
+            }
+
+            bool early = (c.role == ROLE_EARLY_GAME);
+            if ((c.subscribed || early) && !c.handshakeSent && c.role != ROLE_SILENT && t >= c.handshakeAt) {
+                bool game = (c.role != ROLE_SPECTATOR);
+                SCENARIO_EXPECT(mock::write(i, game ? HANDSHAKE : SPECTATOR_HANDSHAKE));
+                c.handshakeSent = true;
+                if (game && gameCentral < 0) {
+                    gameCentral = i;
+                    gameCount++;
+                }
+            }
+        }
+
+        mock::hostStep();
+
+        if (chance(rng, 0.05)) {
+            int next = (int)randomRange(rng, 0, 2);
+            if (next != direction) {
+                direction = next;
+                directionSince = t;
+                updatesSinceChange = 0;
+            }
+        }
+        controller.sendControl(direction);
+        controller.update();
+        updatesSinceChange++;
+
+        // Ready follows the game only
+        bool expectReady = gameCentral >= 0;
+#ifndef DFPONG_USE_NIMBLE
+        expectReady = expectReady && centrals[0].subscribed;
+#endif
+        bool ready = controller.isReady();
+        SCENARIO_EXPECT(ready == expectReady);
+
+        // Directions only reach the game once it has handshaked and
+        // subscribed, and a stall gives the library no chance to send
+        bool subscribed = gameCentral >= 0 && centrals[gameCentral].subscribed;
+        if (gameCount != lastGameCount || (subscribed && !gameSubscribed) || period > 50) {
+            directionSince = t;
+            updatesSinceChange = 0;
+            lastGameCount = gameCount;
+        }
+        gameSubscribed = subscribed;
+
+        if (ready && !wasReady) {
+            if (readyBefore) stats.recovery.push_back(controller.getLastRecoveryTime());
+            if (centrals[gameCentral].role == ROLE_EARLY_GAME) stats.earlyHandshakesReady++;
+            readyBefore = true;
+        }
+        wasReady = ready;
+
+        SCENARIO_EXPECT(controller.getInvariantViolationCount() == 0);
+        SCENARIO_EXPECT(mock::directionsBeforeHandshake() == 0);
+        SCENARIO_EXPECT(controller.getSendQueueDepth() >= 0 && controller.getSendQueueDepth() <= 4);
+
+        // A direction stable since the game could receive it reaches it
+        if (ready && gameSubscribed && updatesSinceChange >= 10 && t - directionSince >= 200) {
+            SCENARIO_EXPECT(mock::lastNotified(gameCentral) == direction);
+        }
+
+        // Never stuck without advertising while a slot is free
+        // (a stall gives the library no chance, so it restarts the window)
+        if (mock::connectionCount() < CENTRALS && !mock::isAdvertising()) {
+            if (notAdvertisingUpdates == 0) notAdvertisingStart = t;
+            if (notAdvertisingUpdates == 0 || period > 50) {
+                notAdvertisingSince = t;
+                notAdvertisingUpdates = 0;
+            }
+            notAdvertisingUpdates++;
+            SCENARIO_EXPECT(notAdvertisingUpdates < 3 || t - notAdvertisingSince < 100);
+        } else {
+            if (notAdvertisingUpdates > 0) stats.readvertise.push_back(t - notAdvertisingStart);
+            notAdvertisingUpdates = 0;
+        }
+    }
+}
+
+// ============================================
+// Host task on its own thread (NimBLE)
+// ============================================
+
+#ifdef DFPONG_USE_NIMBLE
+
+// Callbacks arrive on another thread while loop() runs, on the real clock
+static void testThreadedChurn() {
+    const uint32_t seed = 99;
+    resetStack(seed);
+    mock::useRealClock(true);
+
+    DFPongController controller;
+    controller.setControllerNumber(1);
+    controller.setMaxConnections(CENTRALS);
+    EXPECT(controller.begin());
+
+    std::atomic<bool> running(true);
+    std::thread host([&running]() {
+        std::mt19937 rng(seed);
+        unsigned long lastDisconnect[CENTRALS] = {};
+        while (running) {
+            int i = (int)randomRange(rng, 0, CENTRALS - 1);
+            switch (randomRange(rng, 0, 3)) {
+            case 0:
+                // Handles are reused - give loop() time to see the disconnect
+                if (millis() - lastDisconnect[i] > 20) mock::connect(i);
+                break;
+            case 1:
+                mock::subscribe(i, true);
+                break;
+            case 2:
+                mock::write(i, chance(rng, 0.5) ? HANDSHAKE : SPECTATOR_HANDSHAKE);
+                break;
+            case 3:
+                if (mock::disconnect(i)) lastDisconnect[i] = millis();
+                break;
+            }
+            mock::hostStep();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    std::mt19937 rng(seed + 1);
+    unsigned long end = millis() + 2000;
+    while (millis() < end) {
+        controller.sendControl((int)randomRange(rng, 0, 2));
+        controller.update();
+        EXPECT(controller.getSendQueueDepth() >= 0 && controller.getSendQueueDepth() <= 4);
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+
+    running = false;
+    host.join();
+
+    // Let the loop catch up with the last callbacks
+    end = millis() + 200;
+    while (millis() < end) {
+        mock::hostStep();
+        controller.update();
+    }
+
+    EXPECT(controller.getConnectionCount() == mock::connectionCount());
+    EXPECT(controller.getInvariantViolationCount() == 0);
+    EXPECT(mock::directionsBeforeHandshake() == 0);
+
+    mock::useRealClock(false);
+}
+
+#endif
+
+// ============================================
+// Main
+// ============================================
+
+int main(int argc, char** argv) {
+    int scenarios = (argc > 1) ? atoi(argv[1]) : 2000;
+    uint32_t firstSeed = (argc > 2) ? (uint32_t)strtoul(argv[2], nullptr, 10) : 1;
+
+    ChurnStats stats = {};
+    for (int i = 0; i < scenarios; i++) {
+        runScenario(firstSeed + i, stats);
+    }
+
+    printf("%d scenarios, %d centrals\n", scenarios, CENTRALS);
+    printPercentiles("recovery (ms)", stats.recovery);
+    printPercentiles("re-advertise (ms)", stats.readvertise);
+    printf("%d games ready after handshaking before subscribing\n", stats.earlyHandshakesReady);
+    EXPECT(scenarios < 100 || stats.earlyHandshakesReady > 0);
+
+#ifdef DFPONG_USE_NIMBLE
+    testThreadedChurn();
+#endif
+
+    return finishTests("churn_test");
+}
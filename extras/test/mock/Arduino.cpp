@@ -0,0 +1,147 @@
+/*
+ * Arduino.cpp (host mock)
+ *
+ * Created by Digital Futures OCAD U
+ * MIT License
+ */
+
+#include "Arduino.h"
+#include "MockBLE.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+HardwareSerial Serial;
+
+static std::atomic<unsigned long> virtualTime(0);
+static std::atomic<bool> realClock(false);
+static const std::chrono::steady_clock::time_point realStart = std::chrono::steady_clock::now();
+
+static std::mutex serialLock;
+static std::vector<uint8_t> serialBuffer;
+static bool serialEcho = false;
+
+// ============================================
+// Clock
+// ============================================
+
+static unsigned long realMicros() {
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - realStart).count();
+}
+
+unsigned long millis() {
+    return realClock ? realMicros() / 1000 : virtualTime.load();
+}
+
+unsigned long micros() {
+    return realClock ? realMicros() : virtualTime.load() * 1000;
+}
+
+void delay(unsigned long ms) {
+    if (realClock) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    } else {
+        virtualTime += ms;
+    }
+}
+
+void mock::setTime(unsigned long ms) {
+    virtualTime = ms;
+}
+
+void mock::advance(unsigned long ms) {
+    virtualTime += ms;
+}
+
+void mock::useRealClock(bool enabled) {
+    realClock = enabled;
+}
+
+// ============================================
+// Pins
+// ============================================
+
+static int pinLevels[64];
+
+void pinMode(int pin, int mode) {}
+
+void digitalWrite(int pin, int level) {
+    if (pin >= 0 && pin < 64) pinLevels[pin] = level;
+}
+
+int digitalRead(int pin) {
+    return (pin >= 0 && pin < 64) ? pinLevels[pin] : LOW;
+}
+
+// ============================================
+// Serial
+// ============================================
+
+size_t HardwareSerial::write(uint8_t b) {
+    std::lock_guard<std::mutex> guard(serialLock);
+    serialBuffer.push_back(b);
+    if (serialEcho) putchar(b);
+    return 1;
+}
+
+const std::vector<uint8_t>& mock::serialOutput() {
+    return serialBuffer;
+}
+
+void mock::clearSerial() {
+    std::lock_guard<std::mutex> guard(serialLock);
+    serialBuffer.clear();
+}
+
+void mock::echoSerial(bool enabled) {
+    serialEcho = enabled;
+}
+
+// ============================================
+// Print
+// ============================================
+
+size_t Print::write(const uint8_t* data, size_t length) {
+    for (size_t i = 0; i < length; i++) write(data[i]);
+    return length;
+}
+
+static void printText(Print* out, const char* text) {
+    out->write((const uint8_t*)text, strlen(text));
+}
+
+void Print::print(const char* text) { printText(this, text); }
+void Print::print(char c) { write((uint8_t)c); }
+
+void Print::print(long value, int base) {
+    char text[24];
+    snprintf(text, sizeof(text), base == HEX ? "%lx" : "%ld", value);
+    printText(this, text);
+}
+
+void Print::print(unsigned long value, int base) {
+    char text[24];
+    snprintf(text, sizeof(text), base == HEX ? "%lx" : "%lu", value);
+    printText(this, text);
+}
+
+void Print::print(int value, int base) { print((long)value, base); }
+void Print::print(unsigned int value, int base) { print((unsigned long)value, base); }
+
+void Print::print(double value) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.2f", value);
+    printText(this, text);
+}
+
+void Print::println() { printText(this, "\r\n"); }
+void Print::println(const char* text) { print(text); println(); }
+void Print::println(char c) { print(c); println(); }
+void Print::println(int value, int base) { print(value, base); println(); }
+void Print::println(unsigned int value, int base) { print(value, base); println(); }
+void Print::println(long value, int base) { print(value, base); println(); }
+void Print::println(unsigned long value, int base) { print(value, base); println(); }
+void Print::println(double value) { print(value); println(); }
@@ -0,0 +1,72 @@
+/*
+ * Arduino.h (host mock)
+ *
+ * Just enough of the Arduino core to build DFPongController on a
+ * computer. Time comes from the mock clock in MockBLE.h, Serial
+ * output is captured so tests can read dumpTrace().
+ *
+ * Created by Digital Futures OCAD U
+ * MIT License
+ */
+
+#ifndef DFPONG_MOCK_ARDUINO_H
+#define DFPONG_MOCK_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define DEC 10
+#define HEX 16
+#define LED_BUILTIN 13
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int level);
+int digitalRead(int pin);
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t b) = 0;
+    size_t write(const uint8_t* data, size_t length);
+
+    void print(const char* text);
+    void print(char c);
+    void print(int value, int base = DEC);
+    void print(unsigned int value, int base = DEC);
+    void print(long value, int base = DEC);
+    void print(unsigned long value, int base = DEC);
+    void print(double value);
+
+    void println();
+    void println(const char* text);
+    void println(char c);
+    void println(int value, int base = DEC);
+    void println(unsigned int value, int base = DEC);
+    void println(long value, int base = DEC);
+    void println(unsigned long value, int base = DEC);
+    void println(double value);
+};
+
+class HardwareSerial : public Print {
+public:
+    void begin(unsigned long baud) {}
+    operator bool() const { return true; }
+    size_t write(uint8_t b) override;
+    using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+#endif // DFPONG_MOCK_ARDUINO_H
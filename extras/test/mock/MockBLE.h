@@ -0,0 +1,107 @@
+/*
+ * MockBLE.h
+ *
+ * Control side of the host mocks. Tests play the centrals (the game,
+ * spectators) and the clock; the library talks to the mocked
+ * ArduinoBLE or NimBLE API as it would on a board.
+ *
+ * ArduinoBLE: events are queued and delivered inside BLE.poll(),
+ * like the real library. NimBLE: events are delivered right away,
+ * from whatever thread calls in - the test plays the host task.
+ *
+ * Created by Digital Futures OCAD U
+ * MIT License
+ */
+
+#ifndef DFPONG_MOCK_BLE_H
+#define DFPONG_MOCK_BLE_H
+
+#include <stdint.h>
+#include <vector>
+
+namespace mock {
+
+// ----------------------------------------
+// Clock and Serial (Arduino.cpp)
+// ----------------------------------------
+
+// Virtual clock by default - only moves through setTime()/advance()/delay()
+void setTime(unsigned long ms);
+void advance(unsigned long ms);
+
+// Use the computer's clock instead (benchmarks)
+void useRealClock(bool enabled);
+
+// Everything written to Serial since the last clearSerial()
+const std::vector<uint8_t>& serialOutput();
+void clearSerial();
+
+// Echo Serial to stdout (off by default)
+void echoSerial(bool enabled);
+
+// ----------------------------------------
+// BLE stack (ArduinoBLE.cpp / NimBLEDevice.cpp)
+// ----------------------------------------
+
+// Number of centrals the mock can play
+const int MAX_CENTRALS = 4;
+
+// Forget all stack state - call before every new DFPongController
+void reset();
+
+// Deterministic failures
+void seed(uint32_t value);
+void setNotifyFailRate(double probability);
+
+// Every notification to this central fails while enabled
+void failNotifications(int central, bool enabled);
+
+// The next notification attempt fails (replaying a recorded failure)
+void failNextNotification(bool enabled);
+
+// Drop the next disconnect event (the link still goes down)
+void dropNextDisconnectEvent();
+
+// Disconnects the library asks for complete after this long (default 0)
+void setDisconnectDelay(unsigned long ms);
+
+// Play the host task: deliver disconnects that are due.
+// NimBLE only - ArduinoBLE delivers everything in BLE.poll().
+void hostStep();
+
+// Central actions - return false if not possible right now
+bool connect(int central);
+bool subscribe(int central, bool enabled);
+bool write(int central, uint8_t value);
+bool writeConfig(int central, const uint8_t* data, int length);
+int readConfig(int central, uint8_t* data, int length);
+bool disconnect(int central);
+
+// Stack state
+bool isConnected(int central);
+bool isAdvertising();
+int connectionCount();
+void setRssi(int central, int rssi);
+
+// What a central received
+int lastNotified(int central);             // -1 if nothing since connect
+unsigned long notifyCount(int central);
+unsigned long directionsBeforeHandshake(); // protocol violations, all centrals
+
+// Connection interval the library asked for on this link (0 = none)
+uint16_t requestedIntervalMax(int central);
+
+// Interval the next central is offered: the advertised preferred
+// interval (NimBLE) or setConnectionInterval() (ArduinoBLE)
+uint16_t advertisedIntervalMax();
+
+// Every notification a central got since connect, oldest first
+struct Notification {
+    int value;
+    unsigned long time;  // micros()
+};
+std::vector<Notification> notifications(int central);
+
+} // namespace mock
+
+#endif // DFPONG_MOCK_BLE_H
@@ -0,0 +1,397 @@
+/*
+ * ArduinoBLE.cpp (host mock)
+ *
+ * One central (index 0), like the boards ArduinoBLE runs on.
+ * Central actions are queued and delivered inside BLE.poll().
+ *
+ * Created by Digital Futures OCAD U
+ * MIT License
+ */
+
+#include "ArduinoBLE.h"
+#include "MockBLE.h"
+
+#include <deque>
+#include <random>
+
+BLELocalDevice BLE;
+
+namespace {
+
+enum EventType { EVENT_CONNECT, EVENT_DISCONNECT, EVENT_SUBSCRIBE, EVENT_UNSUBSCRIBE, EVENT_WRITE };
+
+struct PendingEvent {
+    EventType type;
+    std::shared_ptr<MockCharacteristicState> characteristic;
+    unsigned long due;
+};
+
+struct Central {
+    bool link;              // Radio link (changes right away)
+    bool handshaked;        // Wrote HANDSHAKE on this link
+    int lastNotified;
+    unsigned long notifyCount;
+    std::vector<mock::Notification> history;
+    uint16_t requestedIntervalMax;
+    int rssi;
+    bool failing;
+};
+
+// Stack state
+bool attConnected;          // What BLE.connected() reports (changes in poll())
+bool advertising;
+bool dropDisconnect;
+bool failNext;
+unsigned long disconnectDelay;
+uint16_t intervalMax;
+BLEDeviceEventHandler connectedHandler;
+BLEDeviceEventHandler disconnectedHandler;
+std::deque<PendingEvent> pending;
+std::vector<std::shared_ptr<MockCharacteristicState>> characteristics;
+Central peer;           // The one central
+unsigned long violations;
+
+std::mt19937 rng;
+double failRate;
+
+std::shared_ptr<MockCharacteristicState> notifyCharacteristic() {
+    for (auto& c : characteristics) {
+        if (c->properties & BLENotify) return c;
+    }
+    return nullptr;
+}
+
+std::shared_ptr<MockCharacteristicState> configCharacteristic() {
+    for (auto& c : characteristics) {
+        if (!(c->properties & BLENotify) && (c->properties & BLEWrite)) return c;
+    }
+    return nullptr;
+}
+
+} // namespace
+
+// ============================================
+// Control side (MockBLE.h)
+// ============================================
+
+void mock::reset() {
+    attConnected = false;
+    advertising = false;
+    dropDisconnect = false;
+    failNext = false;
+    disconnectDelay = 0;
+    intervalMax = 0;
+    connectedHandler = nullptr;
+    disconnectedHandler = nullptr;
+    pending.clear();
+    characteristics.clear();
+    peer = Central();
+    peer.lastNotified = -1;
+    peer.rssi = -60;
+    violations = 0;
+    failRate = 0;
+}
+
+void mock::seed(uint32_t value) {
+    rng.seed(value);
+}
+
+void mock::setNotifyFailRate(double probability) {
+    failRate = probability;
+}
+
+void mock::failNotifications(int index, bool enabled) {
+    if (index == 0) peer.failing = enabled;
+}
+
+void mock::failNextNotification(bool enabled) {
+    failNext = enabled;
+}
+
+void mock::dropNextDisconnectEvent() {
+    dropDisconnect = true;
+}
+
+void mock::setDisconnectDelay(unsigned long ms) {
+    disconnectDelay = ms;
+}
+
+void mock::hostStep() {}
+
+bool mock::connect(int index) {
+    if (index != 0 || peer.link || !advertising) return false;
+
+    peer.link = true;
+    peer.handshaked = false;
+    peer.lastNotified = -1;
+    peer.notifyCount = 0;
+    peer.history.clear();
+    peer.requestedIntervalMax = intervalMax;
+    advertising = false;  // A connection stops advertising
+    pending.push_back({EVENT_CONNECT, nullptr, 0});
+    return true;
+}
+
+bool mock::subscribe(int index, bool enabled) {
+    if (index != 0 || !peer.link) return false;
+    pending.push_back({enabled ? EVENT_SUBSCRIBE : EVENT_UNSUBSCRIBE, notifyCharacteristic(), 0});
+    return true;
+}
+
+bool mock::write(int index, uint8_t value) {
+    auto c = notifyCharacteristic();
+    if (index != 0 || !peer.link || c == nullptr) return false;
+
+    if (value == 3) peer.handshaked = true;
+    c->value.assign(1, value);
+    pending.push_back({EVENT_WRITE, c, 0});
+    return true;
+}
+
+bool mock::writeConfig(int index, const uint8_t* data, int length) {
+    auto c = configCharacteristic();
+    if (index != 0 || !peer.link || c == nullptr) return false;
+    if (length > c->valueSize) return false;  // ATT rejects it
+
+    if (c->fixedLength) {
+        // Fixed length: the rest keeps the previous value
+        for (int i = 0; i < length; i++) c->value[i] = data[i];
+    } else {
+        c->value.assign(data, data + length);
+    }
+    pending.push_back({EVENT_WRITE, c, 0});
+    return true;
+}
+
+int mock::readConfig(int index, uint8_t* data, int length) {
+    auto c = configCharacteristic();
+    if (index != 0 || !peer.link || c == nullptr) return 0;
+
+    BLECharacteristic handle;
+    handle._state = c;
+    return handle.readValue(data, length);
+}
+
+bool mock::disconnect(int index) {
+    if (index != 0 || !peer.link) return false;
+    peer.link = false;
+    pending.push_back({EVENT_DISCONNECT, nullptr, 0});
+    return true;
+}
+
+bool mock::isConnected(int index) {
+    return index == 0 && peer.link;
+}
+
+bool mock::isAdvertising() {
+    return advertising;
+}
+
+int mock::connectionCount() {
+    return peer.link ? 1 : 0;
+}
+
+void mock::setRssi(int index, int rssi) {
+    if (index == 0) peer.rssi = rssi;
+}
+
+int mock::lastNotified(int index) {
+    return index == 0 ? peer.lastNotified : -1;
+}
+
+unsigned long mock::notifyCount(int index) {
+    return index == 0 ? peer.notifyCount : 0;
+}
+
+unsigned long mock::directionsBeforeHandshake() {
+    return violations;
+}
+
+uint16_t mock::requestedIntervalMax(int index) {
+    return index == 0 ? peer.requestedIntervalMax : 0;
+}
+
+uint16_t mock::advertisedIntervalMax() {
+    return intervalMax;
+}
+
+std::vector<mock::Notification> mock::notifications(int index) {
+    return index == 0 ? peer.history : std::vector<Notification>();
+}
+
+// ============================================
+// BLELocalDevice
+// ============================================
+
+int BLELocalDevice::begin() {
+    return 1;
+}
+
+void BLELocalDevice::end() {}
+
+void BLELocalDevice::poll() {
+    // In order - a delayed disconnect holds back what came after it
+    while (!pending.empty() && millis() >= pending.front().due) {
+        PendingEvent e = pending.front();
+        pending.pop_front();
+
+        switch (e.type) {
+        case EVENT_CONNECT:
+            attConnected = true;
+            if (connectedHandler) connectedHandler(BLEDevice(true));
+            break;
+
+        case EVENT_DISCONNECT:
+            attConnected = false;
+            for (auto& c : characteristics) c->subscribed = false;
+            if (dropDisconnect) {
+                dropDisconnect = false;
+            } else if (disconnectedHandler) {
+                disconnectedHandler(BLEDevice(true));
+            }
+            break;
+
+        case EVENT_SUBSCRIBE:
+        case EVENT_UNSUBSCRIBE:
+            if (e.characteristic) e.characteristic->subscribed = (e.type == EVENT_SUBSCRIBE);
+            break;
+
+        case EVENT_WRITE:
+            if (e.characteristic && e.characteristic->writtenHandler) {
+                BLECharacteristic handle;
+                handle._state = e.characteristic;
+                e.characteristic->writtenHandler(BLEDevice(true), handle);
+            }
+            break;
+        }
+    }
+}
+
+void BLELocalDevice::poll(unsigned long timeout) {
+    poll();
+}
+
+bool BLELocalDevice::connected() {
+    return attConnected;
+}
+
+bool BLELocalDevice::disconnect() {
+    if (!peer.link) return false;
+    peer.link = false;
+    pending.push_back({EVENT_DISCONNECT, nullptr, millis() + disconnectDelay});
+    return true;
+}
+
+int BLELocalDevice::advertise() {
+    if (peer.link) return 0;
+    advertising = true;
+    return 1;
+}
+
+void BLELocalDevice::stopAdvertise() {
+    advertising = false;
+}
+
+BLEDevice BLELocalDevice::central() {
+    return BLEDevice(attConnected);
+}
+
+void BLELocalDevice::setEventHandler(BLEDeviceEvent event, BLEDeviceEventHandler handler) {
+    if (event == BLEConnected) connectedHandler = handler;
+    if (event == BLEDisconnected) disconnectedHandler = handler;
+}
+
+void BLELocalDevice::setConnectionInterval(uint16_t minimum, uint16_t maximum) {
+    intervalMax = maximum;
+}
+
+// ============================================
+// BLEDevice
+// ============================================
+
+bool BLEDevice::connected() {
+    return _valid && attConnected;
+}
+
+int BLEDevice::rssi() {
+    return peer.link ? peer.rssi : 0;
+}
+
+const char* BLEDevice::address() {
+    return "00:11:22:33:44:55";
+}
+
+// ============================================
+// Characteristics
+// ============================================
+
+BLECharacteristic::BLECharacteristic() {}
+
+BLECharacteristic::BLECharacteristic(const char* uuid, uint8_t properties, int valueSize, bool fixedLength) {
+    _state = std::make_shared<MockCharacteristicState>();
+    _state->uuid = uuid;
+    _state->properties = properties;
+    _state->valueSize = valueSize;
+    _state->fixedLength = fixedLength;
+    _state->value.assign(fixedLength ? valueSize : 0, 0);
+    _state->subscribed = false;
+    _state->writtenHandler = nullptr;
+    characteristics.push_back(_state);
+}
+
+const char* BLECharacteristic::uuid() {
+    return _state->uuid;
+}
+
+bool BLECharacteristic::subscribed() {
+    return _state->subscribed;
+}
+
+int BLECharacteristic::valueLength() {
+    return (int)_state->value.size();
+}
+
+const uint8_t* BLECharacteristic::value() {
+    return _state->value.data();
+}
+
+int BLECharacteristic::readValue(uint8_t* data, int length) {
+    int count = valueLength() < length ? valueLength() : length;
+    memcpy(data, _state->value.data(), count);
+    return count;
+}
+
+int BLECharacteristic::writeValue(const uint8_t* data, int length) {
+    if (length > _state->valueSize) return 0;
+    _state->value.assign(data, data + length);
+    if (!_state->subscribed) return 1;
+
+    // Notification to the central
+    if (!peer.link || peer.failing) return 0;
+    if (failNext) {
+        failNext = false;
+        return 0;
+    }
+    if (failRate > 0 && std::uniform_real_distribution<double>(0, 1)(rng) < failRate) return 0;
+
+    peer.lastNotified = data[0];
+    peer.notifyCount++;
+    peer.history.push_back({data[0], micros()});
+    if (data[0] <= 2 && !peer.handshaked) violations++;
+    return 1;
+}
+
+void BLECharacteristic::setEventHandler(int event, BLECharacteristicEventHandler handler) {
+    if (event == BLEWritten) _state->writtenHandler = handler;
+}
+
+BLEByteCharacteristic::BLEByteCharacteristic(const char* uuid, uint8_t properties)
+    : BLECharacteristic(uuid, properties, 1, true) {}
+
+byte BLEByteCharacteristic::value() {
+    return _state->value.empty() ? 0 : _state->value[0];
+}
+
+int BLEByteCharacteristic::writeValue(byte value) {
+    return BLECharacteristic::writeValue(&value, 1);
+}
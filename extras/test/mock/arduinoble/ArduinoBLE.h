@@ -0,0 +1,123 @@
+/*
+ * ArduinoBLE.h (host mock)
+ *
+ * The part of the ArduinoBLE API that DFPongController uses.
+ * Driven from tests through MockBLE.h.
+ *
+ * Created by Digital Futures OCAD U
+ * MIT License
+ */
+
+#ifndef DFPONG_MOCK_ARDUINOBLE_H
+#define DFPONG_MOCK_ARDUINOBLE_H
+
+#include <Arduino.h>
+#include <memory>
+#include <vector>
+
+enum BLEDeviceEvent {
+    BLEConnected = 0,
+    BLEDisconnected
+};
+
+enum BLECharacteristicEvent {
+    BLESubscribed = 0,
+    BLEUnsubscribed,
+    BLERead_Event,
+    BLEWritten
+};
+
+enum BLEProperty {
+    BLEBroadcast = 0x01,
+    BLERead = 0x02,
+    BLEWriteWithoutResponse = 0x04,
+    BLEWrite = 0x08,
+    BLENotify = 0x10,
+    BLEIndicate = 0x20
+};
+
+class BLEDevice {
+public:
+    BLEDevice(bool valid = false) : _valid(valid) {}
+    operator bool() const { return _valid; }
+    bool connected();
+    int rssi();
+    const char* address();
+
+private:
+    bool _valid;
+};
+
+class BLECharacteristic;
+typedef void (*BLEDeviceEventHandler)(BLEDevice device);
+typedef void (*BLECharacteristicEventHandler)(BLEDevice device, BLECharacteristic characteristic);
+
+// Shared by copies, like the real library's reference counted handles
+struct MockCharacteristicState {
+    const char* uuid;
+    uint8_t properties;
+    int valueSize;
+    bool fixedLength;
+    std::vector<uint8_t> value;
+    bool subscribed;
+    BLECharacteristicEventHandler writtenHandler;
+};
+
+class BLECharacteristic {
+public:
+    BLECharacteristic();
+    BLECharacteristic(const char* uuid, uint8_t properties, int valueSize, bool fixedLength = false);
+
+    const char* uuid();
+    bool subscribed();
+    int valueLength();
+    const uint8_t* value();
+    int readValue(uint8_t* data, int length);
+    int writeValue(const uint8_t* data, int length);
+    void setEventHandler(int event, BLECharacteristicEventHandler handler);
+
+    std::shared_ptr<MockCharacteristicState> _state;
+};
+
+class BLEByteCharacteristic : public BLECharacteristic {
+public:
+    BLEByteCharacteristic(const char* uuid, uint8_t properties);
+    byte value();
+    int writeValue(byte value);
+};
+
+class BLEService {
+public:
+    BLEService(const char* uuid) : _uuid(uuid) {}
+    const char* uuid() { return _uuid; }
+    void addCharacteristic(BLECharacteristic& characteristic) {}
+
+private:
+    const char* _uuid;
+};
+
+class BLELocalDevice {
+public:
+    int begin();
+    void end();
+    void poll();
+    void poll(unsigned long timeout);
+    bool connected();
+    bool disconnect();
+    int advertise();
+    void stopAdvertise();
+    BLEDevice central();
+
+    void setEventHandler(BLEDeviceEvent event, BLEDeviceEventHandler handler);
+    void setLocalName(const char* name) {}
+    void setAdvertisedServiceUuid(const char* uuid) {}
+    void setConnectionInterval(uint16_t minimum, uint16_t maximum);
+    void setPairable(bool pairable) {}
+    void setAdvertisingInterval(uint16_t interval) {}
+    int setManufacturerData(const uint8_t* data, int length) { return 1; }
+    void addService(BLEService& service) {}
+};
+
+extern BLELocalDevice BLE;
+
+#endif // DFPONG_MOCK_ARDUINOBLE_H
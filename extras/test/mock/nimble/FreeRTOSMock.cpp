@@ -0,0 +1,76 @@
+/*
+ * FreeRTOSMock.cpp
+ *
+ * Created by Digital Futures OCAD U
+ * MIT License
+ */
+
+#include "FreeRTOSMock.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+
+struct MockTask {
+    std::mutex lock;
+    std::condition_variable wake;
+    uint32_t notifyValue = 0;
+    bool pending = false;
+};
+
+static thread_local MockTask* currentTask = nullptr;
+
+BaseType_t xTaskCreatePinnedToCore(void (*function)(void*), const char* name, uint32_t stackDepth,
+                                   void* parameter, UBaseType_t priority, TaskHandle_t* created,
+                                   BaseType_t core) {
+    MockTask* task = new MockTask();
+    if (created != nullptr) *created = task;
+
+    // Tasks never return, the thread ends with the process
+    std::thread([function, parameter, task]() {
+        currentTask = task;
+        function(parameter);
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+    if (task == nullptr) return pdFAIL;
+    {
+        std::lock_guard<std::mutex> guard(task->lock);
+        switch (action) {
+        case eNoAction:
+            break;
+        case eSetBits:
+            task->notifyValue |= value;
+            break;
+        case eIncrement:
+            task->notifyValue++;
+            break;
+        case eSetValueWithOverwrite:
+        case eSetValueWithoutOverwrite:
+            task->notifyValue = value;
+            break;
+        }
+        task->pending = true;
+    }
+    task->wake.notify_one();
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t bitsToClearOnEntry, uint32_t bitsToClearOnExit,
+                           uint32_t* notificationValue, TickType_t ticksToWait) {
+    MockTask* task = currentTask;
+    if (task == nullptr) return pdFALSE;
+
+    std::unique_lock<std::mutex> guard(task->lock);
+    if (!task->pending) task->notifyValue &= ~bitsToClearOnEntry;
+    task->wake.wait_for(guard, std::chrono::milliseconds(ticksToWait),
+                        [task]() { return task->pending; });
+
+    if (notificationValue != nullptr) *notificationValue = task->notifyValue;
+    if (!task->pending) return pdFALSE;
+    task->pending = false;
+    task->notifyValue &= ~bitsToClearOnExit;
+    return pdTRUE;
+}
@@ -0,0 +1,57 @@
+/*
+ * FreeRTOSMock.h
+ *
+ * FreeRTOS task and critical section calls used by DFPongController
+ * on ESP32, mapped to std::thread so the radio task runs unchanged
+ * on a computer. Tick = 1 ms.
+ *
+ * Created by Digital Futures OCAD U
+ * MIT License
+ */
+
+#ifndef DFPONG_MOCK_FREERTOS_H
+#define DFPONG_MOCK_FREERTOS_H
+
+#include <stdint.h>
+#include <mutex>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+struct MockTask;
+typedef MockTask* TaskHandle_t;
+
+#define pdPASS 1
+#define pdFAIL 0
+#define pdTRUE 1
+#define pdFALSE 0
+#define portMAX_DELAY 0xFFFFFFFFUL
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+BaseType_t xTaskCreatePinnedToCore(void (*function)(void*), const char* name, uint32_t stackDepth,
+                                   void* parameter, UBaseType_t priority, TaskHandle_t* created,
+                                   BaseType_t core);
+
+// Task notifications (only eSetBits is used)
+typedef enum {
+    eNoAction = 0,
+    eSetBits,
+    eIncrement,
+    eSetValueWithOverwrite,
+    eSetValueWithoutOverwrite
+} eNotifyAction;
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action);
+BaseType_t xTaskNotifyWait(uint32_t bitsToClearOnEntry, uint32_t bitsToClearOnExit,
+                           uint32_t* notificationValue, TickType_t ticksToWait);
+
+// Critical sections (a spinlock on ESP32)
+struct portMUX_TYPE {
+    std::mutex lock;
+};
+#define portMUX_INITIALIZER_UNLOCKED {}
+#define portENTER_CRITICAL(mux) ((mux)->lock.lock())
+#define portEXIT_CRITICAL(mux) ((mux)->lock.unlock())
+
+#endif // DFPONG_MOCK_FREERTOS_H
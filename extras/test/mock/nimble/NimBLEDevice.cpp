@@ -0,0 +1,431 @@
+/*
+ * NimBLEDevice.cpp (host mock)
+ *
+ * Central actions call the library callbacks right away on the
+ * calling thread, which plays the NimBLE host task. The stack state
+ * is locked, so a test can run the host on its own thread.
+ *
+ * Created by Digital Futures OCAD U
+ * MIT License
+ */
+
+#include "NimBLEDevice.h"
+#include "MockBLE.h"
+
+#include <deque>
+#include <mutex>
+#include <random>
+
+namespace {
+
+struct Central {
+    bool link;
+    bool subscribed;
+    bool handshaked;        // Wrote HANDSHAKE or SPECTATOR_HANDSHAKE on this link
+    int lastNotified;
+    unsigned long notifyCount;
+    std::vector<mock::Notification> history;
+    uint16_t requestedIntervalMax;
+    int rssi;
+    bool failing;
+};
+
+struct PendingDisconnect {
+    int central;
+    unsigned long due;
+};
+
+std::recursive_mutex stackLock;
+
+NimBLEServer* server;
+NimBLEAdvertising* advertisingObject;
+std::vector<NimBLEService*> services;
+std::vector<NimBLECharacteristic*> characteristics;
+bool advertising;
+bool dropDisconnect;
+bool failNext;
+unsigned long disconnectDelay;
+std::deque<PendingDisconnect> pendingDisconnects;
+Central centrals[mock::MAX_CENTRALS];
+unsigned long violations;
+
+std::mt19937 rng;
+double failRate;
+
+int centralFor(uint16_t connHandle) {
+    int index = (int)connHandle - 1;
+    return (index >= 0 && index < mock::MAX_CENTRALS) ? index : -1;
+}
+
+NimBLECharacteristic* findCharacteristic(bool notify) {
+    for (NimBLECharacteristic* c : characteristics) {
+        if (((c->getProperties() & NIMBLE_PROPERTY::NOTIFY) != 0) == notify) return c;
+    }
+    return nullptr;
+}
+
+// Link is gone - tell the library (outside the lock, like the host task)
+void deliverDisconnect(int index, int reason) {
+    bool drop;
+    {
+        std::lock_guard<std::recursive_mutex> guard(stackLock);
+        drop = dropDisconnect;
+        dropDisconnect = false;
+    }
+    if (drop || server == nullptr || server->getCallbacks() == nullptr) return;
+
+    NimBLEConnInfo info(index + 1);
+    server->getCallbacks()->onDisconnect(server, info, reason);
+}
+
+} // namespace
+
+// ============================================
+// Control side (MockBLE.h)
+// ============================================
+
+void mock::reset() {
+    std::lock_guard<std::recursive_mutex> guard(stackLock);
+    // Old objects are leaked on purpose - a controller from an earlier
+    // scenario may still hold pointers to them
+    server = nullptr;
+    advertisingObject = nullptr;
+    services.clear();
+    characteristics.clear();
+    advertising = false;
+    dropDisconnect = false;
+    failNext = false;
+    disconnectDelay = 0;
+    pendingDisconnects.clear();
+    for (auto& c : centrals) {
+        c = Central();
+        c.lastNotified = -1;
+        c.rssi = -60;
+    }
+    violations = 0;
+    failRate = 0;
+}
+
+void mock::seed(uint32_t value) {
+    std::lock_guard<std::recursive_mutex> guard(stackLock);
+    rng.seed(value);
+}
+
+void mock::setNotifyFailRate(double probability) {
+    std::lock_guard<std::recursive_mutex> guard(stackLock);
+    failRate = probability;
+}
+
+void mock::failNotifications(int index, bool enabled) {
+    std::lock_guard<std::recursive_mutex> guard(stackLock);
+    if (index >= 0 && index < MAX_CENTRALS) centrals[index].failing = enabled;
+}
+
+void mock::failNextNotification(bool enabled) {
+    std::lock_guard<std::recursive_mutex> guard(stackLock);
+    failNext = enabled;
+}
+
+void mock::dropNextDisconnectEvent() {
+    std::lock_guard<std::recursive_mutex> guard(stackLock);
+    dropDisconnect = true;
+}
+
+void mock::setDisconnectDelay(unsigned long ms) {
+    std::lock_guard<std::recursive_mutex> guard(stackLock);
+    disconnectDelay = ms;
+}
+
+void mock::hostStep() {
+    for (;;) {
+        int index;
+        {
+            std::lock_guard<std::recursive_mutex> guard(stackLock);
+            if (pendingDisconnects.empty() || millis() < pendingDisconnects.front().due) return;
+            index = pendingDisconnects.front().central;
+            pendingDisconnects.pop_front();
+        }
+        deliverDisconnect(index, 0x216);  // Terminated by local host
+    }
+}
+
+bool mock::connect(int index) {
+    {
+        std::lock_guard<std::recursive_mutex> guard(stackLock);
+        if (index < 0 || index >= MAX_CENTRALS || centrals[index].link || !advertising) return false;
+
+        // Handles are reused per central, so wait for the old link to be reported gone
+        for (auto& p : pendingDisconnects) {
+            if (p.central == index) return false;
+        }
+
+        Central& c = centrals[index];
+        c.link = true;
+        c.subscribed = false;
+        c.handshaked = false;
+        c.lastNotified = -1;
+        c.notifyCount = 0;
+        c.history.clear();
+        c.requestedIntervalMax = 0;
+        advertising = false;  // A connection stops advertising
+    }
+
+    NimBLEConnInfo info(index + 1);
+    if (server != nullptr && server->getCallbacks() != nullptr) {
+        server->getCallbacks()->onConnect(server, info);
+    }
+    return true;
+}
+
+bool mock::subscribe(int index, bool enabled) {
+    NimBLECharacteristic* characteristic;
+    {
+        std::lock_guard<std::recursive_mutex> guard(stackLock);
+        if (index < 0 || index >= MAX_CENTRALS || !centrals[index].link) return false;
+        centrals[index].subscribed = enabled;
+        characteristic = findCharacteristic(true);
+    }
+
+    NimBLEConnInfo info(index + 1);
+    if (characteristic != nullptr && characteristic->getCallbacks() != nullptr) {
+        characteristic->getCallbacks()->onSubscribe(characteristic, info, enabled ? 1 : 0);
+    }
+    return true;
+}
+
+bool mock::write(int index, uint8_t value) {
+    NimBLECharacteristic* characteristic;
+    {
+        std::lock_guard<std::recursive_mutex> guard(stackLock);
+        characteristic = findCharacteristic(true);
+        if (index < 0 || index >= MAX_CENTRALS || !centrals[index].link || characteristic == nullptr) {
+            return false;
+        }
+        if (value == 3 || value == 4) centrals[index].handshaked = true;
+        characteristic->setValue(&value, 1);
+    }
+
+    NimBLEConnInfo info(index + 1);
+    if (characteristic->getCallbacks() != nullptr) {
+        characteristic->getCallbacks()->onWrite(characteristic, info);
+    }
+    return true;
+}
+
+bool mock::writeConfig(int index, const uint8_t* data, int length) {
+    NimBLECharacteristic* characteristic;
+    {
+        std::lock_guard<std::recursive_mutex> guard(stackLock);
+        characteristic = findCharacteristic(false);
+        if (index < 0 || index >= MAX_CENTRALS || !centrals[index].link || characteristic == nullptr) {
+            return false;
+        }
+        characteristic->setValue(data, length);
+    }
+
+    NimBLEConnInfo info(index + 1);
+    if (characteristic->getCallbacks() != nullptr) {
+        characteristic->getCallbacks()->onWrite(characteristic, info);
+    }
+    return true;
+}
+
+int mock::readConfig(int index, uint8_t* data, int length) {
+    std::lock_guard<std::recursive_mutex> guard(stackLock);
+    NimBLECharacteristic* characteristic = findCharacteristic(false);
+    if (index < 0 || index >= MAX_CENTRALS || !centrals[index].link || characteristic == nullptr) return 0;
+
+    NimBLEAttValue value = characteristic->getValue();
+    int count = (int)value.size() < length ? (int)value.size() : length;
+    memcpy(data, value.data(), count);
+    return count;
+}
+
+bool mock::disconnect(int index) {
+    {
+        std::lock_guard<std::recursive_mutex> guard(stackLock);
+        if (index < 0 || index >= MAX_CENTRALS || !centrals[index].link) return false;
+        centrals[index].link = false;
+        centrals[index].subscribed = false;
+    }
+    deliverDisconnect(index, 0x213);  // Remote user terminated
+    return true;
+}
+
+bool mock::isConnected(int index) {
+    std::lock_guard<std::recursive_mutex> guard(stackLock);
+    return index >= 0 && index < MAX_CENTRALS && centrals[index].link;
+}
+
+bool mock::isAdvertising() {
+    std::lock_guard<std::recursive_mutex> guard(stackLock);
+    return advertising;
+}
+
+int mock::connectionCount() {
+    std::lock_guard<std::recursive_mutex> guard(stackLock);
+    int count = 0;
+    for (auto& c : centrals) {
+        if (c.link) count++;
+    }
+    return count;
+}
+
+void mock::setRssi(int index, int rssi) {
+    std::lock_guard<std::recursive_mutex> guard(stackLock);
+    if (index >= 0 && index < MAX_CENTRALS) centrals[index].rssi = rssi;
+}
+
+int mock::lastNotified(int index) {
+    std::lock_guard<std::recursive_mutex> guard(stackLock);
+    return (index >= 0 && index < MAX_CENTRALS) ? centrals[index].lastNotified : -1;
+}
+
+unsigned long mock::notifyCount(int index) {
+    std::lock_guard<std::recursive_mutex> guard(stackLock);
+    return (index >= 0 && index < MAX_CENTRALS) ? centrals[index].notifyCount : 0;
+}
+
+unsigned long mock::directionsBeforeHandshake() {
+    std::lock_guard<std::recursive_mutex> guard(stackLock);
+    return violations;
+}
+
+uint16_t mock::requestedIntervalMax(int index) {
+    std::lock_guard<std::recursive_mutex> guard(stackLock);
+    return (index >= 0 && index < MAX_CENTRALS) ? centrals[index].requestedIntervalMax : 0;
+}
+
+uint16_t mock::advertisedIntervalMax() {
+    std::lock_guard<std::recursive_mutex> guard(stackLock);
+    return (advertisingObject != nullptr) ? advertisingObject->_maxPreferred : 0;
+}
+
+std::vector<mock::Notification> mock::notifications(int index) {
+    std::lock_guard<std::recursive_mutex> guard(stackLock);
+    return (index >= 0 && index < MAX_CENTRALS) ? centrals[index].history : std::vector<Notification>();
+}
+
+// ============================================
+// NimBLE API
+// ============================================
+
+extern "C" int ble_gap_conn_rssi(uint16_t connHandle, int8_t* rssi) {
+    std::lock_guard<std::recursive_mutex> guard(stackLock);
+    int index = centralFor(connHandle);
+    if (index < 0 || !centrals[index].link) return 7;  // BLE_HS_ENOTCONN
+    *rssi = (int8_t)centrals[index].rssi;
+    return 0;
+}
+
+void NimBLECharacteristic::setValue(const uint8_t* data, size_t length) {
+    std::lock_guard<std::recursive_mutex> guard(stackLock);
+    _value.assign(data, data + length);
+}
+
+NimBLEAttValue NimBLECharacteristic::getValue() {
+    std::lock_guard<std::recursive_mutex> guard(stackLock);
+    return NimBLEAttValue(_value);
+}
+
+bool NimBLECharacteristic::notify(uint16_t connHandle) {
+    NimBLEAttValue value = getValue();
+    return notify(value.data(), value.size(), connHandle);
+}
+
+bool NimBLECharacteristic::notify(const uint8_t* data, size_t length, uint16_t connHandle) {
+    std::lock_guard<std::recursive_mutex> guard(stackLock);
+    int index = centralFor(connHandle);
+    if (index < 0 || length == 0) return false;
+
+    Central& c = centrals[index];
+    if (!c.link || !c.subscribed || c.failing) return false;
+    if (failNext) {
+        failNext = false;
+        return false;
+    }
+    if (failRate > 0 && std::uniform_real_distribution<double>(0, 1)(rng) < failRate) return false;
+
+    c.lastNotified = data[0];
+    c.notifyCount++;
+    c.history.push_back({data[0], micros()});
+    if (data[0] <= 2 && !c.handshaked) violations++;
+    return true;
+}
+
+NimBLECharacteristic* NimBLEService::createCharacteristic(const char* uuid, uint32_t properties, uint16_t maxLength) {
+    std::lock_guard<std::recursive_mutex> guard(stackLock);
+    characteristics.push_back(new NimBLECharacteristic(uuid, properties));
+    return characteristics.back();
+}
+
+NimBLEService* NimBLEServer::createService(const char* uuid) {
+    std::lock_guard<std::recursive_mutex> guard(stackLock);
+    services.push_back(new NimBLEService());
+    return services.back();
+}
+
+int NimBLEServer::getConnectedCount() {
+    return mock::connectionCount();
+}
+
+bool NimBLEServer::disconnect(uint16_t connHandle, uint8_t reason) {
+    std::lock_guard<std::recursive_mutex> guard(stackLock);
+    int index = centralFor(connHandle);
+    if (index < 0 || !centrals[index].link) return false;
+
+    // The link goes now, the host reports it later (hostStep())
+    centrals[index].link = false;
+    centrals[index].subscribed = false;
+    pendingDisconnects.push_back({index, millis() + disconnectDelay});
+    return true;
+}
+
+void NimBLEServer::updateConnParams(uint16_t connHandle, uint16_t minInterval, uint16_t maxInterval,
+                                    uint16_t latency, uint16_t timeout) {
+    std::lock_guard<std::recursive_mutex> guard(stackLock);
+    int index = centralFor(connHandle);
+    if (index >= 0 && centrals[index].link) centrals[index].requestedIntervalMax = maxInterval;
+}
+
+bool NimBLEAdvertising::isAdvertising() {
+    return mock::isAdvertising();
+}
+
+bool NimBLEAdvertising::start() {
+    return NimBLEDevice::startAdvertising();
+}
+
+bool NimBLEAdvertising::stop() {
+    return NimBLEDevice::stopAdvertising();
+}
+
+NimBLEServer* NimBLEDevice::createServer() {
+    std::lock_guard<std::recursive_mutex> guard(stackLock);
+    if (server == nullptr) server = new NimBLEServer();
+    return server;
+}
+
+NimBLEAdvertising* NimBLEDevice::getAdvertising() {
+    std::lock_guard<std::recursive_mutex> guard(stackLock);
+    if (advertisingObject == nullptr) advertisingObject = new NimBLEAdvertising();
+    return advertisingObject;
+}
+
+bool NimBLEDevice::startAdvertising() {
+    std::lock_guard<std::recursive_mutex> guard(stackLock);
+    // No connectable advertising once every link is in use
+    int count = 0;
+    for (auto& c : centrals) {
+        if (c.link) count++;
+    }
+    if (count >= CONFIG_BT_NIMBLE_MAX_CONNECTIONS) return false;
+    advertising = true;
+    return true;
+}
+
+bool NimBLEDevice::stopAdvertising() {
+    std::lock_guard<std::recursive_mutex> guard(stackLock);
+    advertising = false;
+    return true;
+}
@@ -0,0 +1,149 @@
+/*
+ * NimBLEDevice.h (host mock)
+ *
+ * The part of the NimBLE-Arduino 2.x API that DFPongController uses.
+ * Up to mock::MAX_CENTRALS centrals, connection handle = index + 1.
+ * Driven from tests through MockBLE.h.
+ *
+ * Created by Digital Futures OCAD U
+ * MIT License
+ */
+
+#ifndef DFPONG_MOCK_NIMBLE_DEVICE_H
+#define DFPONG_MOCK_NIMBLE_DEVICE_H
+
+#include <Arduino.h>
+#include <string>
+#include <vector>
+#include "FreeRTOSMock.h"
+
+#define ESP_PWR_LVL_P9 9
+#define BLE_HS_CONN_HANDLE_NONE 0xFFFF
+
+#ifndef CONFIG_BT_NIMBLE_MAX_CONNECTIONS
+    #define CONFIG_BT_NIMBLE_MAX_CONNECTIONS 3
+#endif
+#define CONFIG_BT_NIMBLE_PINNED_TO_CORE 0
+
+extern "C" int ble_gap_conn_rssi(uint16_t connHandle, int8_t* rssi);
+
+namespace NIMBLE_PROPERTY {
+    enum {
+        READ = 0x0002,
+        WRITE_NR = 0x0004,
+        WRITE = 0x0008,
+        NOTIFY = 0x0010,
+        INDICATE = 0x0020
+    };
+}
+
+class NimBLEAddress {
+public:
+    std::string toString() const { return "00:11:22:33:44:55"; }
+};
+
+class NimBLEConnInfo {
+public:
+    explicit NimBLEConnInfo(uint16_t connHandle) : _connHandle(connHandle) {}
+    NimBLEAddress getAddress() const { return NimBLEAddress(); }
+    uint16_t getConnHandle() const { return _connHandle; }
+
+private:
+    uint16_t _connHandle;
+};
+
+class NimBLEAttValue {
+public:
+    NimBLEAttValue() {}
+    NimBLEAttValue(const std::vector<uint8_t>& value) : _value(value) {}
+    const uint8_t* data() const { return _value.data(); }
+    size_t size() const { return _value.size(); }
+    size_t length() const { return _value.size(); }
+    uint8_t operator[](int index) const { return index < (int)_value.size() ? _value[index] : 0; }
+
+private:
+    std::vector<uint8_t> _value;
+};
+
+class NimBLEServer;
+class NimBLECharacteristic;
+
+class NimBLEServerCallbacks {
+public:
+    virtual ~NimBLEServerCallbacks() {}
+    virtual void onConnect(NimBLEServer* pServer, NimBLEConnInfo& connInfo) {}
+    virtual void onDisconnect(NimBLEServer* pServer, NimBLEConnInfo& connInfo, int reason) {}
+};
+
+class NimBLECharacteristicCallbacks {
+public:
+    virtual ~NimBLECharacteristicCallbacks() {}
+    virtual void onRead(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) {}
+    virtual void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) {}
+    virtual void onSubscribe(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo, uint16_t subValue) {}
+};
+
+class NimBLECharacteristic {
+public:
+    NimBLECharacteristic(const char* uuid, uint32_t properties) : _uuid(uuid), _properties(properties) {}
+
+    void setCallbacks(NimBLECharacteristicCallbacks* callbacks) { _callbacks = callbacks; }
+    NimBLECharacteristicCallbacks* getCallbacks() { return _callbacks; }
+    void setValue(const uint8_t* data, size_t length);
+    NimBLEAttValue getValue();
+    bool notify(uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE);
+    bool notify(const uint8_t* data, size_t length, uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE);
+    uint32_t getProperties() { return _properties; }
+
+private:
+    const char* _uuid;
+    uint32_t _properties;
+    std::vector<uint8_t> _value;
+    NimBLECharacteristicCallbacks* _callbacks = nullptr;
+};
+
+class NimBLEService {
+public:
+    NimBLECharacteristic* createCharacteristic(const char* uuid, uint32_t properties, uint16_t maxLength = 512);
+    bool start() { return true; }
+};
+
+class NimBLEServer {
+public:
+    void setCallbacks(NimBLEServerCallbacks* callbacks, bool deleteCallbacks = true) { _callbacks = callbacks; }
+    NimBLEServerCallbacks* getCallbacks() { return _callbacks; }
+    NimBLEService* createService(const char* uuid);
+    int getConnectedCount();
+    bool disconnect(uint16_t connHandle, uint8_t reason = 0x13);
+    void updateConnParams(uint16_t connHandle, uint16_t minInterval, uint16_t maxInterval,
+                          uint16_t latency, uint16_t timeout);
+
+private:
+    NimBLEServerCallbacks* _callbacks = nullptr;
+};
+
+class NimBLEAdvertising {
+public:
+    bool addServiceUUID(const char* uuid) { return true; }
+    bool setScanResponse(bool enabled) { return true; }
+    void setMinPreferred(uint16_t interval) { _minPreferred = interval; }
+    void setMaxPreferred(uint16_t interval) { _maxPreferred = interval; }
+    bool isAdvertising();
+    bool start();
+    bool stop();
+
+    uint16_t _minPreferred = 0;
+    uint16_t _maxPreferred = 0;
+};
+
+class NimBLEDevice {
+public:
+    static bool init(const std::string& deviceName) { return true; }
+    static bool setPower(int power) { return true; }
+    static NimBLEServer* createServer();
+    static NimBLEAdvertising* getAdvertising();
+    static bool startAdvertising();
+    static bool stopAdvertising();
+};
+
+#endif // DFPONG_MOCK_NIMBLE_DEVICE_H
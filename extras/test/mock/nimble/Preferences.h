@@ -0,0 +1,55 @@
+/*
+ * Preferences.h (host mock)
+ *
+ * NVS stand-in kept in memory for the life of the process, so a
+ * second controller sees what the first one saved.
+ *
+ * Created by Digital Futures OCAD U
+ * MIT License
+ */
+
+#ifndef DFPONG_MOCK_PREFERENCES_H
+#define DFPONG_MOCK_PREFERENCES_H
+
+#include <Arduino.h>
+#include <map>
+#include <string>
+#include <vector>
+
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false) {
+        _name = name;
+        return true;
+    }
+
+    void end() {}
+
+    size_t getBytes(const char* key, void* data, size_t length) {
+        auto it = store().find(_name + "/" + key);
+        if (it == store().end() || it->second.size() > length) return 0;
+        memcpy(data, it->second.data(), it->second.size());
+        return it->second.size();
+    }
+
+    size_t putBytes(const char* key, const void* data, size_t length) {
+        const uint8_t* bytes = (const uint8_t*)data;
+        store()[_name + "/" + key].assign(bytes, bytes + length);
+        return length;
+    }
+
+    // Test helper - forget everything saved
+    static void clearAll() {
+        store().clear();
+    }
+
+private:
+    std::string _name;
+
+    static std::map<std::string, std::vector<uint8_t>>& store() {
+        static std::map<std::string, std::vector<uint8_t>> values;
+        return values;
+    }
+};
+
+#endif // DFPONG_MOCK_PREFERENCES_H
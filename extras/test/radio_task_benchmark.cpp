@@ -0,0 +1,161 @@
+/*
+ * radio_task_benchmark.cpp
+ *
+ * Input-to-notify latency for a sketch whose loop() now and then
+ * blocks on a slow sensor read: sending from loop() compared with
+ * useRadioTask(). ESP32 build only. Runs on the computer's clock,
+ * with the radio task on a std::thread through the FreeRTOS mock.
+ *
+ * The sketch also traces, profiles and clears, dumps and restarts
+ * the trace from loop() while the radio task writes to it.
+ *
+ * Timing depends on the machine, so only the 90th percentile is
+ * checked, with plenty of margin.
+ *
+ * Created by Digital Futures OCAD U
+ * MIT License
+ */
+
+#include "TestSupport.h"
+
+#include <stdlib.h>
+
+const unsigned long RUN_MS = 5000;
+const unsigned long LOOP_MS = 2;
+const unsigned long BLOCK_MS = 40;     // Slow sensor read
+const double BLOCK_CHANCE = 0.25;
+const unsigned long LATE_US = 35000;   // Notification interval + task period + slack
+const int TRACE_EVERY = 50;            // Loops between trace restarts
+
+struct Input {
+    int value;
+    unsigned long time;  // micros()
+};
+
+// Time from sendControl() with a new direction until the game has
+// it, or a newer one if it was replaced before it went out
+static std::vector<unsigned long> latencies(const std::vector<Input>& inputs,
+                                            const std::vector<mock::Notification>& sent) {
+    const unsigned long NEVER = (unsigned long)-1;
+
+    // When each input reached the game, if it did. The game may
+    // already show it (a replaced direction changed back in time).
+    std::vector<unsigned long> delivered(inputs.size(), NEVER);
+    for (size_t i = 0; i < inputs.size(); i++) {
+        unsigned long limit = (i + 1 < inputs.size()) ? inputs[i + 1].time : NEVER;
+        int shown = -1;
+        for (const mock::Notification& n : sent) {
+            if (n.time < inputs[i].time) {
+                shown = n.value;
+            } else if (shown == inputs[i].value) {
+                delivered[i] = inputs[i].time;
+                break;
+            } else if (n.value == inputs[i].value && n.time < limit) {
+                delivered[i] = n.time;
+                break;
+            }
+        }
+        if (delivered[i] == NEVER && shown == inputs[i].value) delivered[i] = inputs[i].time;
+    }
+
+    std::vector<unsigned long> result;
+    unsigned long next = NEVER;
+    for (size_t i = inputs.size(); i-- > 0;) {
+        if (delivered[i] < next) next = delivered[i];
+        if (next != NEVER) result.push_back(next - inputs[i].time);
+    }
+    return result;
+}
+
+static int countAbove(const std::vector<unsigned long>& values, unsigned long limit) {
+    int count = 0;
+    for (unsigned long v : values) {
+        if (v > limit) count++;
+    }
+    return count;
+}
+
+static std::vector<unsigned long> runSketch(bool radioTask) {
+    resetStack(1);
+    mock::useRealClock(true);
+
+    // Never freed - a radio task runs until the process ends
+    DFPongController* controller = new DFPongController();
+    controller->setControllerNumber(1);
+    controller->useRadioTask(radioTask);
+    controller->enableTrace(256);
+    controller->enableLoopProfiler(true);
+    EXPECT(controller->begin());
+
+    EXPECT(mock::connect(0));
+    EXPECT(mock::subscribe(0, true));
+    EXPECT(mock::write(0, HANDSHAKE));
+    unsigned long deadline = millis() + 1000;
+    while (!controller->isReady() && millis() < deadline) {
+        controller->update();
+        delay(1);
+    }
+    EXPECT(controller->isReady());
+
+    std::mt19937 rng(2);
+    std::vector<Input> inputs;
+    int direction = NEUTRAL;
+    unsigned long nextChange = millis();
+    unsigned long end = millis() + RUN_MS;
+    for (int loops = 0; millis() < end; loops++) {
+        if (millis() >= nextChange) {
+            direction = (direction + 1 + (int)randomRange(rng, 0, 1)) % 3;
+            inputs.push_back({direction, micros()});
+            nextChange = millis() + randomRange(rng, 5, 30);
+        }
+        controller->sendControl(direction);
+        controller->update();
+
+        switch (loops % TRACE_EVERY) {
+        case 0:
+            mock::clearSerial();
+            controller->dumpTrace();
+            break;
+        case 10:
+            controller->clearTrace();
+            break;
+        case 20:
+            controller->disableTrace();
+            break;
+        case 21:
+            controller->enableTrace(256);
+            break;
+        }
+        delay(chance(rng, BLOCK_CHANCE) ? BLOCK_MS : LOOP_MS);
+    }
+
+    // Let the last notification go out
+    delay(100);
+    controller->update();
+
+    // The trace survived being restarted under the radio task
+    int headerCount = -1;
+    std::vector<DFPongTraceEvent> trace = readTrace(*controller, &headerCount);
+    EXPECT(headerCount == (int)trace.size());
+
+    std::vector<unsigned long> result = latencies(inputs, mock::notifications(0));
+    printPercentiles(radioTask ? "radio task (us)" : "loop() (us)", result);
+    printf("%-20s %d of %zu over %lu us\n", "", countAbove(result, LATE_US), result.size(), LATE_US);
+    return result;
+}
+
+int main() {
+    std::vector<unsigned long> fromLoop = runSketch(false);
+    std::vector<unsigned long> task = runSketch(true);
+
+    EXPECT(!fromLoop.empty() && !task.empty());
+    // A blocked loop() holds back paced directions until it returns.
+    // The radio task sends them when the notification interval is up.
+    EXPECT(countAbove(fromLoop, LATE_US) > 0);
+    EXPECT(percentile(task, 90) < LATE_US);
+
+    // The radio task thread is still running - skip static destructors
+    int result = finishTests("radio_task_benchmark");
+    fflush(stdout);
+    _Exit(result);
+}
@@ -0,0 +1,372 @@
+/*
+ * regression_test.cpp
+ *
+ * Scenarios that pin down fixed behaviour, run against the
+ * ArduinoBLE and the NimBLE build of the library:
+ *
+ *   - the handshake timeout is traced once per connection
+ *   - the trace never holds more events than its dump header can count
+ *   - remote config: short writes are rejected, and a tuned connection
+ *     interval reaches every later connection, also after a restart,
+ *     but only once one has been written
+ *   - turning the loop profiler off keeps its results
+ *   - a good begin() clears the error pattern of a failed one
+ *   - invariant violations are counted once and left unrepaired
+ *   - only the game makes an ESP32 ready, and a failing spectator
+ *     never delays it
+ *
+ * Created by Digital Futures OCAD U
+ * MIT License
+ */
+
+#include "TestSupport.h"
+
+#ifdef DFPONG_USE_NIMBLE
+#include <Preferences.h>
+#endif
+
+// ============================================
+// Helpers
+// ============================================
+
+static void makeConfig(uint8_t* data, uint16_t interval, uint16_t connMin, uint16_t connMax) {
+    uint16_t values[] = {interval, 5000, 500, 100};
+    data[0] = DFPONG_CONFIG_VERSION;
+    for (int i = 0; i < 4; i++) {
+        data[1 + i * 2] = values[i] & 0xFF;
+        data[2 + i * 2] = values[i] >> 8;
+    }
+    data[9] = (uint8_t)(int8_t)-70;
+    data[10] = connMin & 0xFF;
+    data[11] = connMin >> 8;
+    data[12] = connMax & 0xFF;
+    data[13] = connMax >> 8;
+}
+
+// Connect, subscribe and handshake one central
+static void joinGame(DFPongController& controller, int central, uint8_t handshake = HANDSHAKE) {
+    EXPECT(mock::connect(central));
+    EXPECT(mock::subscribe(central, true));
+    runFor(controller, 50);
+    EXPECT(mock::write(central, handshake));
+    runFor(controller, 50);
+}
+
+static int countLedChanges(DFPongController& controller, int pin, unsigned long ms) {
+    int changes = 0;
+    int level = digitalRead(pin);
+    for (unsigned long t = 0; t < ms; t += 10) {
+        mock::advance(10);
+        controller.update();
+        if (digitalRead(pin) != level) {
+            level = digitalRead(pin);
+            changes++;
+        }
+    }
+    return changes;
+}
+
+// ============================================
+// Both platforms
+// ============================================
+
+// The timeout used to be traced (and disconnect() called) on every
+// update() until the disconnect event arrived
+static void testHandshakeTimeoutTracedOnce() {
+    resetStack(1);
+    DFPongController controller;
+    controller.setControllerNumber(1);
+    controller.enableTrace(256);
+    EXPECT(controller.begin());
+    mock::setDisconnectDelay(1000);
+    runFor(controller, 100);
+
+    EXPECT(mock::connect(0));
+    EXPECT(mock::subscribe(0, true));
+    runFor(controller, 7000);
+
+    std::vector<DFPongTraceEvent> trace = readTrace(controller);
+    EXPECT(countEvents(trace, DFPONG_TRACE_HANDSHAKE_TIMEOUT) == 1);
+    EXPECT(countEvents(trace, DFPONG_TRACE_DISCONNECTED) == 1);
+    EXPECT(!mock::isConnected(0));
+    EXPECT(mock::isAdvertising());
+}
+
+// The dump header stores the count as uint16
+static void testTraceSizeCapped() {
+    resetStack(2);
+    DFPongController controller;
+    controller.setControllerNumber(1);
+    EXPECT(controller.enableTrace(100000));
+    EXPECT(controller.begin());
+
+    for (int i = 0; i < 70000; i++) {
+        controller.sendControl(i % 2 == 0 ? UP : DOWN);
+    }
+    EXPECT(controller.getTraceLength() == 0xFFFF);
+
+    int headerCount = -1;
+    std::vector<DFPongTraceEvent> trace = readTrace(controller, &headerCount);
+    EXPECT(headerCount == 0xFFFF);
+    EXPECT((int)trace.size() == headerCount);
+}
+
+// A short config write must not be merged with the old value
+static void testShortConfigRejected() {
+    resetStack(3);
+    DFPongController controller;
+    controller.setControllerNumber(1);
+    controller.enableRemoteConfig();
+    EXPECT(controller.begin());
+    runFor(controller, 100);
+    EXPECT(mock::connect(0));
+    runFor(controller, 50);
+
+    uint8_t config[DFPONG_CONFIG_SIZE];
+    makeConfig(config, 50, 24, 40);
+    EXPECT(mock::writeConfig(0, config, sizeof(config)));
+    runFor(controller, 50);
+
+    uint8_t shorter[DFPONG_CONFIG_SIZE];
+    makeConfig(shorter, 10, 24, 40);
+    EXPECT(mock::writeConfig(0, shorter, DFPONG_CONFIG_SIZE - 1));
+    runFor(controller, 50);
+
+    uint8_t readBack[DFPONG_CONFIG_SIZE] = {0};
+    EXPECT(mock::readConfig(0, readBack, sizeof(readBack)) == DFPONG_CONFIG_SIZE);
+    EXPECT(readBack[1] == 50);
+}
+
+// The tuned interval has to reach connections made after the write
+static void testIntervalReachesNewConnections() {
+    resetStack(4);
+    DFPongController controller;
+    controller.setControllerNumber(1);
+    controller.enableRemoteConfig();
+    EXPECT(controller.begin());
+    runFor(controller, 100);
+    EXPECT(mock::connect(0));
+    runFor(controller, 50);
+
+    uint8_t config[DFPONG_CONFIG_SIZE];
+    makeConfig(config, 20, 24, 40);
+    EXPECT(mock::writeConfig(0, config, sizeof(config)));
+    runFor(controller, 50);
+
+#ifdef DFPONG_USE_NIMBLE
+    EXPECT(mock::requestedIntervalMax(0) == 40);
+#endif
+
+    EXPECT(mock::disconnect(0));
+    runFor(controller, 200);
+    EXPECT(mock::connect(0));
+    runFor(controller, 50);
+    EXPECT(mock::requestedIntervalMax(0) == 40);
+}
+
+// Disabling the profiler keeps the results readable
+static void testProfilerKeepsResults() {
+    resetStack(5);
+    DFPongController controller;
+    controller.setControllerNumber(1);
+    EXPECT(controller.begin());
+
+    controller.enableLoopProfiler(true);
+    runFor(controller, 500, 5);
+    controller.enableLoopProfiler(false);
+    EXPECT(controller.getLoopTimeMax() >= 5000);
+
+    // Enabling again starts clean
+    controller.enableLoopProfiler(true);
+    EXPECT(controller.getLoopTimeMax() == 0);
+}
+
+// A failed begin() left the error pattern on after a good one
+static void testErrorClearedByBegin() {
+    resetStack(6);
+    const int pin = 13;
+    DFPongController controller;
+    controller.setStatusLED(pin);
+    EXPECT(!controller.begin());
+    int errorChanges = countLedChanges(controller, pin, 2000);
+
+    controller.setControllerNumber(1);
+    EXPECT(controller.begin());
+    int blinkChanges = countLedChanges(controller, pin, 2000);
+
+    EXPECT(errorChanges >= 10);
+    EXPECT(blinkChanges <= 8);
+}
+
+// ============================================
+// ArduinoBLE only
+// ============================================
+
+#ifndef DFPONG_USE_NIMBLE
+
+// A lost disconnect event is counted once, not on every update()
+static void testMissedDisconnectCountedOnce() {
+    resetStack(7);
+    DFPongController controller;
+    controller.setControllerNumber(1);
+    controller.enableTrace(256);
+    EXPECT(controller.begin());
+    runFor(controller, 100);
+    joinGame(controller, 0);
+    EXPECT(controller.isReady());
+
+    mock::dropNextDisconnectEvent();
+    EXPECT(mock::disconnect(0));
+    runFor(controller, 500);
+
+    EXPECT(!controller.isReady());
+    EXPECT(controller.getInvariantViolationCount() == 1);
+    std::vector<DFPongTraceEvent> trace = readTrace(controller);
+    EXPECT(countEvents(trace, DFPONG_TRACE_INVARIANT) == 1);
+}
+
+#endif
+
+// ============================================
+// NimBLE only
+// ============================================
+
+#ifdef DFPONG_USE_NIMBLE
+
+// Only the game makes the controller ready
+static void testSpectatorNeverReady() {
+    resetStack(8);
+    DFPongController controller;
+    controller.setControllerNumber(1);
+    controller.setMaxConnections(3);
+    EXPECT(controller.begin());
+    runFor(controller, 100);
+
+    joinGame(controller, 1, SPECTATOR_HANDSHAKE);
+    EXPECT(!controller.isReady());
+
+    joinGame(controller, 0);
+    EXPECT(controller.isReady());
+
+    // Losing the game is not ready, even with the spectator still there
+    EXPECT(mock::disconnect(0));
+    runFor(controller, 50);
+    EXPECT(!controller.isReady());
+    EXPECT(controller.getConnectionCount() == 1);
+
+    // The next HANDSHAKE is the new game
+    joinGame(controller, 2);
+    EXPECT(controller.isReady());
+    EXPECT(controller.getLastRecoveryTime() > 0);
+}
+
+// Retries to a spectator never hold back the game
+static void testSpectatorDoesNotDelayGame() {
+    resetStack(9);
+    DFPongController controller;
+    controller.setControllerNumber(1);
+    controller.setMaxConnections(2);
+    EXPECT(controller.begin());
+    runFor(controller, 100);
+    joinGame(controller, 0);
+    joinGame(controller, 1, SPECTATOR_HANDSHAKE);
+    EXPECT(controller.isReady());
+
+    mock::failNotifications(1, true);
+    int direction = NEUTRAL;
+    int late = 0;
+    for (int change = 0; change < 100; change++) {
+        direction = (direction == UP) ? DOWN : UP;
+
+        // Changes further apart than the interval go out at once
+        for (int ms = 0; ms < 37; ms++) {
+            mock::advance(1);
+            controller.sendControl(direction);
+            controller.update();
+            if (ms == 1 && mock::lastNotified(0) != direction) late++;
+        }
+    }
+    EXPECT(late == 0);
+    EXPECT(controller.getInvariantViolationCount() == 0);
+}
+
+// Settings loaded from flash are asked for on every connection
+static void testSavedIntervalAppliedOnConnect() {
+    Preferences::clearAll();
+
+    resetStack(10);
+    DFPongController first;
+    first.setControllerNumber(1);
+    first.enableRemoteConfig(true);
+    EXPECT(first.begin());
+    runFor(first, 100);
+    EXPECT(mock::connect(0));
+    runFor(first, 50);
+    uint8_t config[DFPONG_CONFIG_SIZE];
+    makeConfig(config, 20, 24, 40);
+    EXPECT(mock::writeConfig(0, config, sizeof(config)));
+    runFor(first, 50);
+
+    resetStack(11);
+    DFPongController second;
+    second.setControllerNumber(1);
+    second.enableRemoteConfig(true);
+    EXPECT(second.begin());
+    EXPECT(mock::advertisedIntervalMax() == 40);
+    runFor(second, 100);
+    EXPECT(mock::connect(0));
+    runFor(second, 50);
+    EXPECT(mock::requestedIntervalMax(0) == 40);
+
+    Preferences::clearAll();
+}
+
+// Enabling remote config alone keeps the advertised defaults
+// and asks no connection for a different interval
+static void testDefaultIntervalUntilConfigured() {
+    Preferences::clearAll();
+
+    resetStack(12);
+    DFPongController controller;
+    controller.setControllerNumber(1);
+    controller.enableRemoteConfig(true);
+    EXPECT(controller.begin());
+    EXPECT(mock::advertisedIntervalMax() == 0x12);
+    runFor(controller, 100);
+    EXPECT(mock::connect(0));
+    runFor(controller, 50);
+    EXPECT(mock::requestedIntervalMax(0) == 0);
+
+    uint8_t config[DFPONG_CONFIG_SIZE];
+    makeConfig(config, 20, 24, 40);
+    EXPECT(mock::writeConfig(0, config, sizeof(config)));
+    runFor(controller, 50);
+    EXPECT(mock::requestedIntervalMax(0) == 40);
+    EXPECT(mock::advertisedIntervalMax() == 40);
+
+    Preferences::clearAll();
+}
+
+#endif
+
+// ============================================
+// Main
+// ============================================
+
+int main() {
+    testHandshakeTimeoutTracedOnce();
+    testTraceSizeCapped();
+    testShortConfigRejected();
+    testIntervalReachesNewConnections();
+    testProfilerKeepsResults();
+    testErrorClearedByBegin();
+#ifdef DFPONG_USE_NIMBLE
+    testSpectatorNeverReady();
+    testSpectatorDoesNotDelayGame();
+    testSavedIntervalAppliedOnConnect();
+    testDefaultIntervalUntilConfigured();
+#else
+    testMissedDisconnectCountedOnce();
+#endif
+    return finishTests("regression_test");
+}
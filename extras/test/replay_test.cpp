@@ -0,0 +1,314 @@
+/*
+ * replay_test.cpp
+ *
+ * Feeds a recorded trace (enableTrace() + dumpTrace()) back through
+ * the library on the mock clock and records it again.
+ *
+ *   replay_test_<platform>             record seeded sessions, replay
+ *                                      them and require the same trace
+ *   replay_test_<platform> trace.bin   replay a capture from a board and
+ *                                      print input-to-notify latency
+ *
+ * The trace does not say which central did something, so connects go
+ * to the first free central and disconnects and handshakes to the
+ * oldest one. Loops the board ran between trace events are replayed
+ * as 1 ms loops, except inside a recorded STALL. Single-central
+ * traces replay exactly.
+ *
+ * Created by Digital Futures OCAD U
+ * MIT License
+ */
+
+#include "TestSupport.h"
+
+#include <fstream>
+#include <iterator>
+
+const unsigned long SESSION_MS = 20000;
+
+// ============================================
+// Helpers
+// ============================================
+
+// Input-to-notify latency of every direction change sent while ready
+static std::vector<unsigned long> inputLatencies(const std::vector<DFPongTraceEvent>& trace) {
+    std::vector<unsigned long> latencies;
+    bool ready = false;
+    bool pending = false;
+    uint32_t pendingTime = 0;
+    int pendingValue = 0;
+
+    for (const DFPongTraceEvent& e : trace) {
+        switch (e.event) {
+        case DFPONG_TRACE_HANDSHAKE:
+            if (e.value == HANDSHAKE) ready = true;
+            break;
+        case DFPONG_TRACE_DISCONNECTED:
+            ready = false;
+            pending = false;
+            break;
+        case DFPONG_TRACE_SEND_CONTROL:
+            pending = ready;
+            pendingTime = e.time;
+            pendingValue = e.value;
+            break;
+        case DFPONG_TRACE_NOTIFY_OK:
+            if (pending && e.value == pendingValue) {
+                latencies.push_back(e.time - pendingTime);
+                pending = false;
+            }
+            break;
+        }
+    }
+    return latencies;
+}
+
+static void printSummary(const char* name, const std::vector<DFPongTraceEvent>& trace) {
+    printf("%s: %zu events, %d notifications, %d failed\n", name, trace.size(),
+           countEvents(trace, DFPONG_TRACE_NOTIFY_OK), countEvents(trace, DFPONG_TRACE_NOTIFY_FAILED));
+    printPercentiles("  latency (ms)", inputLatencies(trace));
+}
+
+static int firstDifference(const std::vector<DFPongTraceEvent>& a, const std::vector<DFPongTraceEvent>& b) {
+    size_t count = a.size() < b.size() ? a.size() : b.size();
+    for (size_t i = 0; i < count; i++) {
+        if (a[i].time != b[i].time || a[i].event != b[i].event ||
+            a[i].value != b[i].value || a[i].extra != b[i].extra) {
+            return (int)i;
+        }
+    }
+    return (a.size() == b.size()) ? -1 : (int)count;
+}
+
+// ============================================
+// Record
+// ============================================
+
+// A game session with 1 ms loops, stalls, silent centrals and failing notifications
+static std::vector<DFPongTraceEvent> recordSession(uint32_t seed) {
+    resetStack(seed);
+    std::mt19937 rng(seed);
+    mock::setNotifyFailRate(0.1);
+
+    DFPongController controller;
+    controller.setControllerNumber(1);
+    controller.enableTrace(0xFFFF);
+    controller.enableLoopProfiler(true);
+    EXPECT(controller.begin());
+
+    bool connected = false;
+    bool handshakeSent = false;
+    bool silent = false;
+    unsigned long handshakeAt = 0;
+    int direction = NEUTRAL;
+
+    unsigned long end = millis() + SESSION_MS;
+    while (millis() < end) {
+        mock::advance(chance(rng, 0.01) ? randomRange(rng, 30, 200) : 1);
+        unsigned long t = millis();
+
+        if (connected && !mock::isConnected(0)) connected = false;
+
+        if (!connected) {
+            if (chance(rng, 0.01) && mock::connect(0)) {
+                EXPECT(mock::subscribe(0, true));
+                connected = true;
+                handshakeSent = false;
+                silent = chance(rng, 0.1);
+                handshakeAt = t + randomRange(rng, 0, 300);
+            }
+        } else if (chance(rng, 0.0005)) {
+            EXPECT(mock::disconnect(0));
+            connected = false;
+        } else if (!handshakeSent && !silent && t >= handshakeAt) {
+            EXPECT(mock::write(0, HANDSHAKE));
+            handshakeSent = true;
+        }
+
+        if (chance(rng, 0.02)) direction = (int)randomRange(rng, 0, 2);
+
+        mock::hostStep();
+        controller.sendControl(direction);
+        controller.update();
+    }
+    return readTrace(controller);
+}
+
+// ============================================
+// Replay
+// ============================================
+
+static std::vector<DFPongTraceEvent> replay(const std::vector<DFPongTraceEvent>& input) {
+    if (input.empty()) return input;
+
+    // Loops the recording never ran, and how many centrals it had
+    std::vector<std::pair<unsigned long, unsigned long>> stalls;
+    int maxConnections = 1;
+    for (const DFPongTraceEvent& e : input) {
+        if (e.event == DFPONG_TRACE_STALL) stalls.push_back({e.time - e.extra, e.time});
+        if (e.event == DFPONG_TRACE_CONNECTED && e.extra > maxConnections) maxConnections = e.extra;
+    }
+
+    unsigned long start = input.front().time - 1;
+    resetStack(0);
+    mock::setTime(start);
+
+    DFPongController controller;
+    controller.setControllerNumber(1);
+#ifdef DFPONG_USE_NIMBLE
+    controller.setMaxConnections(maxConnections);
+#endif
+    size_t capacity = input.size() * 2 + 64;
+    controller.enableTrace(capacity > 0xFFFF ? 0xFFFF : (int)capacity);
+    controller.enableLoopProfiler(true);
+    EXPECT(controller.begin());
+
+    std::vector<int> connected;  // Oldest first
+    bool handshaked[mock::MAX_CENTRALS] = {};
+    int libraryDisconnects = 0;
+    int direction = NEUTRAL;
+    size_t next = 0;
+
+    for (unsigned long t = start + 1; t <= input.back().time; t++) {
+        bool stalled = false;
+        for (const auto& stall : stalls) {
+            if (t > stall.first && t < stall.second) stalled = true;
+        }
+        if (stalled) continue;
+        mock::setTime(t);
+
+        // Centrals the library disconnected
+        for (size_t i = 0; i < connected.size();) {
+            if (mock::isConnected(connected[i])) {
+                i++;
+            } else {
+                connected.erase(connected.begin() + i);
+            }
+        }
+
+        bool failNotification = false;
+        for (; next < input.size() && input[next].time <= t; next++) {
+            const DFPongTraceEvent& e = input[next];
+            switch (e.event) {
+            case DFPONG_TRACE_SEND_CONTROL:
+                direction = e.value;
+                break;
+
+            case DFPONG_TRACE_CONNECTED:
+                for (int i = 0; i < mock::MAX_CENTRALS; i++) {
+                    bool used = std::find(connected.begin(), connected.end(), i) != connected.end();
+                    if (!used && mock::connect(i)) {
+                        mock::subscribe(i, true);
+                        connected.push_back(i);
+                        handshaked[i] = false;
+                        break;
+                    }
+                }
+                break;
+
+            case DFPONG_TRACE_DISCONNECTED:
+                if (libraryDisconnects > 0) {
+                    libraryDisconnects--;
+                } else if (!connected.empty()) {
+                    mock::disconnect(connected.front());
+                    connected.erase(connected.begin());
+                }
+                break;
+
+            case DFPONG_TRACE_HANDSHAKE:
+                for (int i : connected) {
+                    if (!handshaked[i]) {
+                        mock::write(i, e.value);
+                        handshaked[i] = true;
+                        break;
+                    }
+                }
+                break;
+
+            case DFPONG_TRACE_HANDSHAKE_TIMEOUT:
+                libraryDisconnects++;
+                break;
+
+            case DFPONG_TRACE_NOTIFY_FAILED:
+                failNotification = true;
+                break;
+            }
+        }
+
+        mock::failNextNotification(failNotification);
+        mock::hostStep();
+        controller.sendControl(direction);
+        controller.update();
+        mock::failNextNotification(false);
+    }
+    return readTrace(controller);
+}
+
+// ============================================
+// Tests
+// ============================================
+
+static void testReplayMatchesRecording(uint32_t seed) {
+    std::vector<DFPongTraceEvent> recorded = recordSession(seed);
+    std::vector<DFPongTraceEvent> replayed = replay(recorded);
+
+    EXPECT(countEvents(recorded, DFPONG_TRACE_HANDSHAKE) > 0);
+    EXPECT(countEvents(recorded, DFPONG_TRACE_NOTIFY_FAILED) > 0);
+    EXPECT(countEvents(recorded, DFPONG_TRACE_STALL) > 0);
+
+    int diff = firstDifference(recorded, replayed);
+    if (diff >= 0) {
+        printf("seed %u: traces differ at event %d of %zu/%zu\n", seed, diff, recorded.size(), replayed.size());
+    }
+    EXPECT(diff < 0);
+
+    // Pacing: never two notification attempts on one connection within the interval
+    uint32_t lastAttempt = 0;
+    for (const DFPongTraceEvent& e : replayed) {
+        if (e.event == DFPONG_TRACE_CONNECTED) lastAttempt = 0;
+        if (e.event != DFPONG_TRACE_NOTIFY_OK && e.event != DFPONG_TRACE_NOTIFY_FAILED) continue;
+        EXPECT(lastAttempt == 0 || e.time - lastAttempt >= 20);
+        lastAttempt = e.time;
+    }
+}
+
+static int replayFile(const char* path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        printf("Cannot open %s\n", path);
+        return 1;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::vector<DFPongTraceEvent> recorded = parseTrace(data);
+    if (recorded.empty()) {
+        printf("%s is not a DFPT trace\n", path);
+        return 1;
+    }
+
+    std::vector<DFPongTraceEvent> replayed = replay(recorded);
+    printSummary("recorded", recorded);
+    printSummary("replayed", replayed);
+
+    int diff = firstDifference(recorded, replayed);
+    if (diff < 0) {
+        printf("replay matches the recording\n");
+    } else {
+        printf("replay differs from event %d\n", diff);
+    }
+    return 0;
+}
+
+// ============================================
+// Main
+// ============================================
+
+int main(int argc, char** argv) {
+    if (argc > 1) {
+        return replayFile(argv[1]);
+    }
+
+    for (uint32_t seed = 1; seed <= 20; seed++) {
+        testReplayMatchesRecording(seed);
+    }
+    return finishTests("replay_test");
+}
@@ -0,0 +1,163 @@
+/*
+ * status_led_test.cpp
+ *
+ * Steps DFPongStatusLED the way its hardware timer does, one tick()
+ * at a time, and checks the exact LED level of every tick for each
+ * pattern and for pattern changes in the middle of a step.
+ *
+ * Created by Digital Futures OCAD U
+ * MIT License
+ */
+
+#include "TestSupport.h"
+
+#include <DFPongStatusLED.h>
+#include <string>
+
+const int PIN = 13;
+const int TICK_MS = DFPongStatusLED::TICK_MS;
+
+// ============================================
+// Helpers
+// ============================================
+
+// LED level after each of the next ticks, '1' = on
+static std::string run(DFPongStatusLED& led, int ticks) {
+    std::string levels;
+    for (int i = 0; i < ticks; i++) {
+        led.tick();
+        levels += (digitalRead(PIN) == HIGH) ? '1' : '0';
+    }
+    return levels;
+}
+
+// Expand per-step levels ("10") to per-tick levels
+static std::string steps(const std::string& levels, unsigned long stepMs) {
+    std::string ticks;
+    for (char level : levels) {
+        ticks += std::string(stepMs / TICK_MS, level);
+    }
+    return ticks;
+}
+
+static void startLed(DFPongStatusLED& led, uint32_t seed) {
+    resetStack(seed);
+    // The mocks have no LED timer, so nothing but the test calls tick()
+    EXPECT(!led.begin(PIN));
+    EXPECT(digitalRead(PIN) == LOW);
+}
+
+// ============================================
+// Patterns
+// ============================================
+
+static void testSolidAndOff() {
+    DFPongStatusLED led;
+    startLed(led, 1);
+
+    led.solid();
+    EXPECT(run(led, 5) == "11111");
+    led.off();
+    EXPECT(run(led, 5) == "00000");
+}
+
+static void testBlink() {
+    DFPongStatusLED led;
+    startLed(led, 2);
+
+    led.blink(500);
+    EXPECT(run(led, 200) == steps("1010", 500));
+
+    DFPongStatusLED fast;
+    startLed(fast, 3);
+    fast.blink(100);
+    EXPECT(run(fast, 60) == steps("101010", 100));
+}
+
+static void testSignal() {
+    const char* expected[] = {
+        "1000000000000000",
+        "1010000000000000",
+        "1010100000000000",
+        "1010101000000000",
+    };
+    for (int bars = 1; bars <= 4; bars++) {
+        DFPongStatusLED led;
+        startLed(led, 10 + bars);
+        led.signal(bars);
+        std::string cycle = steps(expected[bars - 1], 150);
+        EXPECT(run(led, 2 * cycle.size()) == cycle + cycle);
+    }
+
+    // Out of range bar counts are clamped
+    DFPongStatusLED low;
+    startLed(low, 15);
+    low.signal(0);
+    EXPECT(run(low, 240) == steps(expected[0], 150));
+
+    DFPongStatusLED high;
+    startLed(high, 16);
+    high.signal(9);
+    EXPECT(run(high, 240) == steps(expected[3], 150));
+}
+
+static void testError() {
+    DFPongStatusLED led;
+    startLed(led, 20);
+
+    led.error();
+    std::string cycle = steps("1010100000", 100);
+    EXPECT(run(led, 2 * cycle.size()) == cycle + cycle);
+}
+
+// ============================================
+// Pattern Changes
+// ============================================
+
+// Posting the running pattern again does not restart it
+static void testRepostKeepsPhase() {
+    DFPongStatusLED led;
+    startLed(led, 30);
+
+    led.blink(100);
+    std::string levels = run(led, 5);
+    led.blink(100);
+    levels += run(led, 15);
+    EXPECT(levels == steps("10", 100));
+}
+
+// A new pattern starts from its first step on the next tick,
+// wherever the old one was
+static void testSwitchMidStep() {
+    DFPongStatusLED led;
+    startLed(led, 31);
+
+    // 15 ticks: the on step and half of the off step
+    led.blink(100);
+    EXPECT(run(led, 15) == "111111111100000");
+
+    led.error();
+    EXPECT(run(led, 100) == steps("1010100000", 100));
+
+    // Part way into the second flash
+    led.signal(2);
+    EXPECT(run(led, 35) == steps("1010", 150).substr(0, 35));
+    led.off();
+    EXPECT(run(led, 3) == "000");
+    led.blink(500);
+    EXPECT(run(led, 100) == steps("10", 500));
+}
+
+// ============================================
+// Main
+// ============================================
+
+int main() {
+    testSolidAndOff();
+    testBlink();
+    testSignal();
+    testError();
+    testRepostKeepsPhase();
+    testSwitchMidStep();
+    return finishTests("status_led_test");
+}
@@ -10,6 +10,12 @@
 
 #include "DFPongController.h"
 
+#if defined(DFPONG_CONFIG_NVS)
+    #include <Preferences.h>
+#elif defined(DFPONG_CONFIG_EEPROM)
+    #include <EEPROM.h>
+#endif
+
 // ============================================
 // Static Members
 // ============================================
@@ -17,6 +23,39 @@
 // Singleton instance pointer for callbacks
 DFPongController* DFPongController::_instance = nullptr;
 
+// Guards the link event ring between the BLE callbacks and serviceBLE()
+#ifdef DFPONG_USE_NIMBLE
+static portMUX_TYPE linkEventLock = portMUX_INITIALIZER_UNLOCKED;
+#define LINK_EVENT_LOCK()   portENTER_CRITICAL(&linkEventLock)
+#define LINK_EVENT_UNLOCK() portEXIT_CRITICAL(&linkEventLock)
+#else
+// ArduinoBLE callbacks run inside BLE.poll(), on the same task
+#define LINK_EVENT_LOCK()
+#define LINK_EVENT_UNLOCK()
+#endif
+
+// Guards the trace ring between the radio task and loop()
+#ifdef DFPONG_USE_NIMBLE
+static portMUX_TYPE traceLock = portMUX_INITIALIZER_UNLOCKED;
+#define TRACE_LOCK()   portENTER_CRITICAL(&traceLock)
+#define TRACE_UNLOCK() portEXIT_CRITICAL(&traceLock)
+#else
+#define TRACE_LOCK()
+#define TRACE_UNLOCK()
+#endif
+
+// Loop profiler histogram: upper limit of each bucket in microseconds
+// (the last bucket holds everything slower)
+const unsigned long DFPongController::PROFILE_BUCKET_LIMITS[PROFILE_BUCKETS - 1] = {
+    1000, 2000, 5000, 10000, 20000, 30000, 50000, 100000, 200000, 500000
+};
+
+// Recovery histogram: upper limit of each bucket in ms
+// (the last bucket holds everything slower)
+const unsigned long DFPongController::RECOVERY_BUCKET_LIMITS[RECOVERY_BUCKETS - 1] = {
+    250, 500, 1000, 2000, 5000, 10000, 30000
+};
+
 // Manufacturer data: 0xDF = DFPong, 0x01 = version 1
 const uint8_t DFPongController::MANUFACTURER_DATA[2] = {0xDF, 0x01};
 
@@ -28,31 +67,28 @@ const uint8_t DFPongController::MANUFACTURER_DATA[2] = {0xDF, 0x01};
 
 class DFPongController::ServerCallbacks : public NimBLEServerCallbacks {
     void onConnect(NimBLEServer* pServer, NimBLEConnInfo& connInfo) override {
-        if (DFPongController::_instance == nullptr) return;
+        DFPongController* self = DFPongController::_instance;
+        if (self == nullptr) return;
         
         Serial.print("Connected to: ");
         Serial.println(connInfo.getAddress().toString().c_str());
         
-        DFPongController::_instance->_deviceConnected = true;
-        DFPongController::_instance->_handshakeComplete = false;
-        DFPongController::_instance->_lastSentValue = HANDSHAKE;
-        DFPongController::_instance->_valueChanged = true;
-        DFPongController::_instance->_connectionStartTime = millis();
+        self->postLinkEvent(LINK_CONNECTED, connInfo.getConnHandle(), 0);
         
-        if (DFPongController::_instance->_statusLedPin >= 0) {
-            digitalWrite(DFPongController::_instance->_statusLedPin, HIGH);
+        // Keep advertising while there are free slots
+        if (pServer->getConnectedCount() < self->_maxConnections) {
+            NimBLEDevice::startAdvertising();
         }
     }
     
     void onDisconnect(NimBLEServer* pServer, NimBLEConnInfo& connInfo, int reason) override {
-        if (DFPongController::_instance == nullptr) return;
+        DFPongController* self = DFPongController::_instance;
+        if (self == nullptr) return;
         
         Serial.print("Disconnected from: ");
         Serial.println(connInfo.getAddress().toString().c_str());
-        Serial.println("Waiting for connection...");
         
-        DFPongController::_instance->_deviceConnected = false;
-        DFPongController::_instance->resetState();
+        self->postLinkEvent(LINK_DISCONNECTED, connInfo.getConnHandle(), reason);
         
         // Restart advertising
         NimBLEDevice::startAdvertising();
@@ -61,16 +97,32 @@ class DFPongController::ServerCallbacks : public NimBLEServerCallbacks {
 
 class DFPongController::CharacteristicCallbacks : public NimBLECharacteristicCallbacks {
     void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override {
-        if (DFPongController::_instance == nullptr) return;
+        DFPongController* self = DFPongController::_instance;
+        if (self == nullptr) return;
         
         uint8_t value = pCharacteristic->getValue()[0];
         
-        if (value == HANDSHAKE) {
-            DFPongController::_instance->_handshakeComplete = true;
-            DFPongController::_instance->debugPrint("Handshake complete!");
-            Serial.println("Controller ready to play!");
+        if (value == HANDSHAKE || value == SPECTATOR_HANDSHAKE) {
+            self->postLinkEvent(LINK_HANDSHAKE, connInfo.getConnHandle(), value);
         }
     }
+    
+    void onSubscribe(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo, uint16_t subValue) override {
+        DFPongController* self = DFPongController::_instance;
+        if (self == nullptr) return;
+        
+        self->postLinkEvent(LINK_SUBSCRIBED, connInfo.getConnHandle(), subValue);
+    }
+};
+
+class DFPongController::ConfigCallbacks : public NimBLECharacteristicCallbacks {
+    void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override {
+        DFPongController* self = DFPongController::_instance;
+        if (self == nullptr) return;
+        
+        NimBLEAttValue value = pCharacteristic->getValue();
+        self->postConfig(value.data(), value.size());
+    }
 };
 
 #endif // DFPONG_USE_NIMBLE
@@ -88,18 +140,77 @@ DFPongController::DFPongController() {
 #ifdef DFPONG_USE_NIMBLE
     _pServer = nullptr;
     _pAdvertising = nullptr;
+    _maxConnections = 1;
+    _gameSlot = -1;
+    _useRadioTask = false;
+    _radioTask = nullptr;
+    _mailbox.store(-1);
+    _publishedDirection = -1;
+    _radioDirection = -1;
+    for (int i = 0; i < DFPONG_MAX_CONNECTIONS; i++) {
+        _connections[i].active = false;
+        _connections[i].connHandle = BLE_HS_CONN_HANDLE_NONE;
+    }
+#else
+    _notifySent = 0;
+    _notifyFailed = 0;
+    _handshakeTimedOut = false;
 #endif
     _pongService = nullptr;
     _movementCharacteristic = nullptr;
+    _configCharacteristic = nullptr;
+    
+    _remoteConfig = false;
+    _persistConfig = false;
+    _ledBlinkSlow = LED_BLINK_SLOW;
+    _ledBlinkFast = LED_BLINK_FAST;
+    _notificationInterval = MIN_NOTIFICATION_INTERVAL;
+    _handshakeTimeout = HANDSHAKE_TIMEOUT;
+    _connIntervalMin = CONN_INTERVAL_MIN;
+    _connIntervalMax = CONN_INTERVAL_MAX;
+    _connIntervalTuned = false;
     
     _serviceStarted = false;
     _handshakeComplete = false;
     _deviceConnected = false;
-    _ledState = false;
+    _ledShowSignal = false;
+    _ledError = false;
+    _signalBars = 1;
+    _lastSignalCheck = 0;
     _lastSentValue = 0;
-    _valueChanged = false;
     
-    _lastLedToggle = 0;
+    _linkEventHead = 0;
+    _linkEventCount = 0;
+    _linkEventLost = false;
+    _pendingConfigLength = 0;
+    
+    _sendQueueHead = 0;
+    _sendQueueCount = 0;
+    _sendRetryCount = 0;
+    _sendDropCount = 0;
+    
+    _trace = nullptr;
+    _traceCapacity = 0;
+    _traceHead = 0;
+    _traceCount = 0;
+    _lastTracedDirection = -1;
+    _traceDumping = false;
+    
+    _advertising = false;
+    _advertisingLostTime = 0;
+    _disconnectTime = 0;
+    _invariantViolations = 0;
+    _activeInvariants = 0;
+    _lastRecoveryTime = 0;
+    _recoveryTimeMax = 0;
+    for (int i = 0; i < RECOVERY_BUCKETS; i++) {
+        _recoveryHistogram[i] = 0;
+    }
+    
+    _profileLoop = false;
+    _stallCallback = nullptr;
+    resetLoopProfiler();
+    
     _lastNotificationTime = 0;
     _connectionStartTime = 0;
     
@@ -122,18 +233,61 @@ void DFPongController::setControllerNumber(int number) {
 
 void DFPongController::setStatusLED(int pin) {
     _statusLedPin = pin;
-    pinMode(_statusLedPin, OUTPUT);
-    digitalWrite(_statusLedPin, LOW);
+    
+    if (_led.begin(pin)) {
+        debugPrint("Status LED driven by hardware timer");
+    }
+}
+
+void DFPongController::setSignalLED(bool enabled) {
+    _ledShowSignal = enabled;
 }
 
 void DFPongController::setDebug(bool enabled) {
     _debug = enabled;
 }
 
+void DFPongController::setMaxConnections(int count) {
+#ifdef DFPONG_USE_NIMBLE
+    if (count < 1) count = 1;
+    if (count > DFPONG_MAX_CONNECTIONS) count = DFPONG_MAX_CONNECTIONS;
+    _maxConnections = count;
+    debugPrint("Max connections", count);
+#else
+    debugPrint("Multiple connections need ESP32 - using 1");
+#endif
+}
+
+void DFPongController::useRadioTask(bool enabled) {
+#ifdef DFPONG_USE_NIMBLE
+    _useRadioTask = enabled;
+#else
+    if (enabled) {
+        debugPrint("Radio task needs ESP32 - sending from loop()");
+    }
+#endif
+}
+
 void DFPongController::setRSSIThreshold(int dBm) {
     _rssiThreshold = dBm;
 }
 
+void DFPongController::enableRemoteConfig(bool persist) {
+    _remoteConfig = true;
+    _persistConfig = persist;
+    
+#if !defined(DFPONG_CONFIG_NVS) && !defined(DFPONG_CONFIG_EEPROM)
+    if (persist) {
+        debugPrint("Saving config is not supported on this board");
+        _persistConfig = false;
+    }
+#endif
+}
+
+void DFPongController::enableRemoteConfig() {
+    enableRemoteConfig(false);
+}
+
 // ============================================
 // UUID Generation
 // ============================================
@@ -142,6 +296,7 @@ void DFPongController::generateUUIDs() {
     // Base UUIDs (must match JavaScript exactly)
     const char* serviceBase = "19b10010-e8f2-537e-4f6c-d104768a12";
     const char* characteristicBase = "19b10011-e8f2-537e-4f6c-d104768a12";
+    const char* configBase = "19b10012-e8f2-537e-4f6c-d104768a12";
     
     // Calculate unique suffix: device 1 -> 14 (0x0e), device 2 -> 15 (0x0f), etc.
     int suffix = 13 + _controllerNumber;
@@ -149,6 +304,7 @@ void DFPongController::generateUUIDs() {
     // Generate full UUIDs with 2-digit hex suffix
     snprintf(_serviceUuid, sizeof(_serviceUuid), "%s%02x", serviceBase, suffix);
     snprintf(_characteristicUuid, sizeof(_characteristicUuid), "%s%02x", characteristicBase, suffix);
+    snprintf(_configUuid, sizeof(_configUuid), "%s%02x", configBase, suffix);
     
     if (_debug) {
         Serial.print("Service UUID: ");
@@ -170,12 +326,16 @@ bool DFPongController::begin() {
 }
 
 bool DFPongController::begin(const char* deviceName) {
+    // Clear an error left by a failed earlier begin()
+    _ledError = false;
+    
     // Validate controller number
     if (_controllerNumber < 1 || _controllerNumber > 242) {
         Serial.println("========================================");
         Serial.println("ERROR: Call setControllerNumber(1-242)");
         Serial.println("       before calling begin()!");
         Serial.println("========================================");
+        showError();
         return false;
     }
     
@@ -184,6 +344,11 @@ bool DFPongController::begin(const char* deviceName) {
     
     // Generate unique UUIDs based on controller number
     generateUUIDs();
+    
+    // Restore settings pushed by the game host earlier
+    if (_remoteConfig && _persistConfig && loadConfig()) {
+        debugPrint("Loaded saved config");
+    }
 
 #ifdef DFPONG_USE_NIMBLE
     // ========== NimBLE (ESP32) Implementation ==========
@@ -211,6 +376,16 @@ bool DFPongController::begin(const char* deviceName) {
     _movementCharacteristic->setCallbacks(new CharacteristicCallbacks());
     _movementCharacteristic->setValue((uint8_t*)"\0", 1);
     
+    // Optional config characteristic
+    if (_remoteConfig) {
+        _configCharacteristic = _pongService->createCharacteristic(
+            _configUuid,
+            NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE
+        );
+        _configCharacteristic->setCallbacks(new ConfigCallbacks());
+        publishConfig();
+    }
+    
     // Start the service
     _pongService->start();
     
@@ -218,8 +393,14 @@ bool DFPongController::begin(const char* deviceName) {
     _pAdvertising = NimBLEDevice::getAdvertising();
     _pAdvertising->addServiceUUID(_serviceUuid);
     _pAdvertising->setScanResponse(true);
-    _pAdvertising->setMinPreferred(0x06);  // For iPhone compatibility
-    _pAdvertising->setMaxPreferred(0x12);
+    if (_connIntervalTuned) {
+        // Interval loaded from flash
+        _pAdvertising->setMinPreferred(_connIntervalMin);
+        _pAdvertising->setMaxPreferred(_connIntervalMax);
+    } else {
+        _pAdvertising->setMinPreferred(0x06);  // For iPhone compatibility
+        _pAdvertising->setMaxPreferred(0x12);
+    }
     
     // Start advertising
     NimBLEDevice::startAdvertising();
@@ -233,6 +414,14 @@ bool DFPongController::begin(const char* deviceName) {
         _characteristicUuid, 
         BLERead | BLENotify | BLEWrite
     );
+    if (_remoteConfig) {
+        _configCharacteristic = new BLECharacteristic(
+            _configUuid,
+            BLERead | BLEWrite,
+            DFPONG_CONFIG_SIZE,
+            false
+        );
+    }
     
     // Initialize BLE with retry
     debugPrint("Starting BLE...");
@@ -248,6 +437,7 @@ bool DFPongController::begin(const char* deviceName) {
     
     if (!bleStarted) {
         Serial.println("ERROR: BLE failed to initialize!");
+        showError();
         return false;
     }
     
@@ -261,13 +451,16 @@ bool DFPongController::begin(const char* deviceName) {
     BLE.setEventHandler(BLEConnected, onBLEConnected);
     BLE.setEventHandler(BLEDisconnected, onBLEDisconnected);
     _movementCharacteristic->setEventHandler(BLEWritten, onCharacteristicWritten);
+    if (_configCharacteristic != nullptr) {
+        _configCharacteristic->setEventHandler(BLEWritten, onConfigWritten);
+    }
     
     // Configure BLE parameters
     BLE.setLocalName(deviceName);
     BLE.setAdvertisedServiceUuid(_pongService->uuid());
     
     // Optimized connection parameters for crowded environments
-    BLE.setConnectionInterval(12, 24);   // 15-30ms
+    BLE.setConnectionInterval(_connIntervalMin, _connIntervalMax);   // Default 15-30ms
     BLE.setPairable(false);
     BLE.setAdvertisingInterval(160);     // 100ms
     
@@ -276,19 +469,30 @@ bool DFPongController::begin(const char* deviceName) {
     
     // Add characteristic to service and service to BLE
     _pongService->addCharacteristic(*_movementCharacteristic);
+    if (_configCharacteristic != nullptr) {
+        _pongService->addCharacteristic(*_configCharacteristic);
+    }
     BLE.addService(*_pongService);
     
     // Set initial value
     _movementCharacteristic->writeValue(0);
+    publishConfig();
     delay(100);
     
     // Start advertising
     BLE.advertise();
+    _advertising = true;
     
 #endif // DFPONG_USE_NIMBLE
 
     _serviceStarted = true;
     
+#ifdef DFPONG_USE_NIMBLE
+    if (_useRadioTask && !startRadioTask()) {
+        Serial.println("WARNING: Radio task failed to start - sending from loop()");
+    }
+#endif
+    
     Serial.println("========================================");
     Serial.print("DF Pong Controller #");
     Serial.print(_controllerNumber);
@@ -311,57 +515,130 @@ bool DFPongController::begin(const char* deviceName) {
 // ============================================
 
 void DFPongController::update() {
+    unsigned long updateStart = 0;
+    if (_profileLoop) {
+        updateStart = micros();
+        profileLoop(updateStart);
+    }
+    
+#ifdef DFPONG_USE_NIMBLE
+    // The radio task does this work when it is running
+    if (_radioTask == nullptr) {
+        serviceBLE();
+    }
+#else
+    serviceBLE();
+#endif
+    
+    if (_profileLoop) {
+        _loopLibraryTime += micros() - updateStart;
+    }
+}
+
+void DFPongController::serviceBLE() {
 #ifdef DFPONG_USE_NIMBLE
-    // NimBLE handles events automatically via callbacks
-    // Just update LED and check handshake timeout
+    // NimBLE runs its callbacks on its own host task
 #else
     // Process BLE events for ArduinoBLE
     BLE.poll();
 #endif
     
+    // Connection changes posted by the callbacks
+    applyLinkEvents();
+    
+    // Catch connection state that went wrong and make sure
+    // the controller can always be found again
+    if (_serviceStarted) {
+        checkInvariants();
+        checkAdvertising();
+    }
+    
+    // Retry anything a previous send could not deliver
+    flushSendQueue();
+    
     // Update status LED
     updateLED();
     
     // Check for handshake timeout
-    if (isConnected() && !_handshakeComplete) {
-        if (millis() - _connectionStartTime > HANDSHAKE_TIMEOUT) {
-            debugPrint("Handshake timeout - disconnecting");
 #ifdef DFPONG_USE_NIMBLE
-            _pServer->disconnect(0);
+    // Each central has to complete its own handshake.
+    // Handled once - the slot stays until the disconnect event arrives.
+    for (int i = 0; i < DFPONG_MAX_CONNECTIONS; i++) {
+        Connection& c = _connections[i];
+        if (c.active && !c.handshakeComplete && !c.timedOut &&
+            millis() - c.connectionStartTime > _handshakeTimeout) {
+            c.timedOut = true;
+            debugPrint("Handshake timeout - disconnecting");
+            traceEvent(DFPONG_TRACE_HANDSHAKE_TIMEOUT, 0, 0);
+            _pServer->disconnect(c.connHandle);
+        }
+    }
 #else
+    if (isConnected() && !_handshakeComplete && !_handshakeTimedOut) {
+        if (millis() - _connectionStartTime > _handshakeTimeout) {
+            _handshakeTimedOut = true;
+            debugPrint("Handshake timeout - disconnecting");
+            traceEvent(DFPONG_TRACE_HANDSHAKE_TIMEOUT, 0, 0);
             BLE.disconnect();
-#endif
         }
     }
+#endif
 }
 
 // ============================================
 // LED Control
 // ============================================
 
+// Only posts the pattern for the current state - the
+// timer in DFPongStatusLED does the blinking
 void DFPongController::updateLED() {
     if (_statusLedPin < 0) return;  // No LED configured
     
-    unsigned long currentTime = millis();
-    bool connected = isConnected();
-    
-    if (_handshakeComplete && connected) {
-        // Solid ON = ready to play
-        digitalWrite(_statusLedPin, HIGH);
-    } else if (connected) {
-        // Fast blink = connected, handshaking
-        if (currentTime - _lastLedToggle >= LED_BLINK_FAST) {
-            _ledState = !_ledState;
-            digitalWrite(_statusLedPin, _ledState);
-            _lastLedToggle = currentTime;
+    if (_ledError) {
+        // Error = three quick flashes
+        _led.error();
+    } else if (_handshakeComplete && _deviceConnected) {
+        // Solid ON = ready to play (or signal strength flashes)
+        if (_ledShowSignal) {
+            updateSignalBars();
+            _led.signal(_signalBars);
+        } else {
+            _led.solid();
         }
+    } else if (_deviceConnected) {
+        // Fast blink = connected, handshaking
+        _led.blink(_ledBlinkFast);
     } else {
         // Slow blink = disconnected, advertising
-        if (currentTime - _lastLedToggle >= LED_BLINK_SLOW) {
-            _ledState = !_ledState;
-            digitalWrite(_statusLedPin, _ledState);
-            _lastLedToggle = currentTime;
-        }
+        _led.blink(_ledBlinkSlow);
+    }
+    
+    // Boards without a timer backend step the pattern here
+    _led.poll(millis());
+}
+
+// 1-4 flashes: below threshold, then +10 dBm steps above it
+void DFPongController::updateSignalBars() {
+    unsigned long currentTime = millis();
+    if (currentTime - _lastSignalCheck < SIGNAL_CHECK_INTERVAL) return;
+    _lastSignalCheck = currentTime;
+    
+    int rssi = getRSSI();
+    if (rssi == 0 || rssi <= _rssiThreshold) {
+        _signalBars = 1;
+    } else if (rssi <= _rssiThreshold + 10) {
+        _signalBars = 2;
+    } else if (rssi <= _rssiThreshold + 20) {
+        _signalBars = 3;
+    } else {
+        _signalBars = 4;
+    }
+}
+
+void DFPongController::showError() {
+    _ledError = true;
+    if (_statusLedPin >= 0) {
+        _led.error();
     }
 }
 
@@ -370,59 +647,634 @@ void DFPongController::updateLED() {
 // ============================================
 
 void DFPongController::sendControl(int direction) {
+    unsigned long start = _profileLoop ? micros() : 0;
+    
+#ifdef DFPONG_USE_NIMBLE
+    if (_radioTask != nullptr) {
+        publishControl(direction);
+    } else {
+        processControl(direction);
+    }
+#else
+    processControl(direction);
+#endif
+    
+    if (_profileLoop) {
+        _loopLibraryTime += micros() - start;
+    }
+}
+
+void DFPongController::processControl(int direction) {
     // Validate direction
     if (direction < 0 || direction > 2) {
         direction = NEUTRAL;
     }
     
+    // Only changes are traced - sendControl() runs every loop()
+    TRACE_LOCK();
+    bool changed = (direction != _lastTracedDirection);
+    _lastTracedDirection = direction;
+    TRACE_UNLOCK();
+    if (changed) {
+        traceEvent(DFPONG_TRACE_SEND_CONTROL, direction, 0);
+    }
+    
+    // Can't send if not connected
+    if (!isConnected()) {
+        return;
+    }
+    
+    // If handshake not complete, keep sending handshake signal
+    int valueToSend = _handshakeComplete ? direction : HANDSHAKE;
+    
+    queueValue(valueToSend);
+    flushSendQueue();
+}
+
+// ============================================
+// Send Queue
+// ============================================
+
+void DFPongController::queueValue(int value) {
+    // Directions are latest-value-wins: a newer direction
+    // replaces one that has not been sent yet
+    if (value != HANDSHAKE && _sendQueueCount > 0) {
+        int tail = (_sendQueueHead + _sendQueueCount - 1) % SEND_QUEUE_SIZE;
+        if (_sendQueue[tail] != HANDSHAKE) {
+            _sendQueueCount--;
+        }
+    }
+    
+    // Skip if the game will already end up with this value
+    int lastValue = _lastSentValue;
+    if (_sendQueueCount > 0) {
+        lastValue = _sendQueue[(_sendQueueHead + _sendQueueCount - 1) % SEND_QUEUE_SIZE];
+    }
+    if (value == lastValue) {
+        return;
+    }
+    
+    // Queue full - drop the oldest value
+    if (_sendQueueCount == SEND_QUEUE_SIZE) {
+        _sendQueueHead = (_sendQueueHead + 1) % SEND_QUEUE_SIZE;
+        _sendQueueCount--;
+        _sendDropCount++;
+        traceEvent(DFPONG_TRACE_DROPPED, _sendQueue[(_sendQueueHead + SEND_QUEUE_SIZE - 1) % SEND_QUEUE_SIZE], 1);
+        debugPrint("Send queue full - dropped oldest value");
+    }
+    
+    _sendQueue[(_sendQueueHead + _sendQueueCount) % SEND_QUEUE_SIZE] = (uint8_t)value;
+    _sendQueueCount++;
+}
+
+void DFPongController::flushSendQueue() {
 #ifdef DFPONG_USE_NIMBLE
     // Can't send if not connected
     if (!_deviceConnected) {
         return;
     }
 #else
+    if (_sendQueueCount == 0) return;
+    
     // Can't send if not connected or subscribed
     if (!BLE.connected() || !_movementCharacteristic->subscribed()) {
         return;
     }
 #endif
     
-    // If handshake not complete, keep sending handshake signal
-    int valueToSend = _handshakeComplete ? direction : HANDSHAKE;
-    
-    // Check if value changed
-    if (valueToSend != _lastSentValue) {
-        _valueChanged = true;
-    }
-    
-    // Only send if value changed and enough time has passed
     unsigned long currentTime = millis();
-    if (_valueChanged && (currentTime - _lastNotificationTime >= MIN_NOTIFICATION_INTERVAL)) {
+    int value = (_sendQueueCount > 0) ? _sendQueue[_sendQueueHead] : _lastSentValue;
+    int attempted = 0;
+    int failed = 0;
+    int paced = 0;
+    
 #ifdef DFPONG_USE_NIMBLE
-        uint8_t val = (uint8_t)valueToSend;
-        _movementCharacteristic->setValue(&val, 1);
-        _movementCharacteristic->notify();
-        _lastSentValue = valueToSend;
-        _lastNotificationTime = currentTime;
-        _valueChanged = false;
+    // Fan out to every subscribed central in one pass. Centrals that
+    // already have the value are skipped, so a retry only goes to the
+    // ones that failed and a late subscriber catches up.
+    for (int i = 0; i < DFPONG_MAX_CONNECTIONS; i++) {
+        Connection& c = _connections[i];
+        if (!c.active || !c.subscribed) continue;
+        
+        // Centrals still handshaking only get HANDSHAKE
+        int target = c.handshakeComplete ? value : HANDSHAKE;
+        if (target < 0 || target == c.lastSentValue) continue;
+        if (c.handshakeComplete && target == HANDSHAKE) continue;
         
-        if (_debug && valueToSend != HANDSHAKE) {
-            debugPrint("Sent control", valueToSend);
+        // Pace each central on its own, so retries to a struggling
+        // spectator never hold back the game
+        if (currentTime - c.lastNotificationTime < _notificationInterval) {
+            paced++;
+            continue;
         }
+        
+        attempted++;
+        c.lastNotificationTime = currentTime;
+        if (transmitValue(target, c.connHandle)) {
+            c.lastSentValue = target;
+            c.notifySent++;
+        } else {
+            c.notifyFailed++;
+            failed++;
+        }
+    }
 #else
-        if (_movementCharacteristic->writeValue(valueToSend)) {
-            _lastSentValue = valueToSend;
-            _lastNotificationTime = currentTime;
-            _valueChanged = false;
-            
-            if (_debug && valueToSend != HANDSHAKE) {
-                debugPrint("Sent control", valueToSend);
-            }
+    // Pace sends (and retries) to the minimum notification interval
+    if (currentTime - _lastNotificationTime < _notificationInterval) {
+        return;
+    }
+    
+    attempted = 1;
+    _lastNotificationTime = currentTime;
+    if (transmitValue(value)) {
+        _notifySent++;
+    } else {
+        _notifyFailed++;
+        failed = 1;
+    }
+#endif
+    
+    if (failed > 0) {
+        // Leave it queued and retry on the next update()
+        _sendRetryCount++;
+        traceEvent(DFPONG_TRACE_NOTIFY_FAILED, value, _sendQueueCount);
+        return;
+    }
+    
+    // Still owed to a central that has to wait for its interval
+    if (paced > 0) return;
+    
+    if (_sendQueueCount == 0) return;
+    
+    _sendQueueHead = (_sendQueueHead + 1) % SEND_QUEUE_SIZE;
+    _sendQueueCount--;
+    _lastSentValue = value;
+    if (attempted == 0) return;  // Nobody subscribed yet - late subscribers catch up
+    traceEvent(DFPONG_TRACE_NOTIFY_OK, value, _sendQueueCount);
+    
+    if (_debug && value != HANDSHAKE) {
+        debugPrint("Sent control", value);
+    }
+}
+
+#ifdef DFPONG_USE_NIMBLE
+bool DFPongController::transmitValue(int value, uint16_t connHandle) {
+    uint8_t val = (uint8_t)value;
+    _movementCharacteristic->setValue(&val, 1);
+    return _movementCharacteristic->notify(&val, 1, connHandle);
+}
+#else
+bool DFPongController::transmitValue(int value) {
+    return _movementCharacteristic->writeValue((byte)value);
+}
+#endif
+
+void DFPongController::clearSendQueue() {
+    _sendQueueHead = 0;
+    _sendQueueCount = 0;
+}
+
+int DFPongController::getSendQueueDepth() {
+    return _sendQueueCount;
+}
+
+unsigned long DFPongController::getSendRetryCount() {
+    return _sendRetryCount;
+}
+
+unsigned long DFPongController::getSendDropCount() {
+    return _sendDropCount;
+}
+
+// ============================================
+// Remote Config
+// ============================================
+
+static uint16_t readUint16(const uint8_t* data) {
+    return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+static void writeUint16(uint8_t* data, uint16_t value) {
+    data[0] = (uint8_t)(value & 0xFF);
+    data[1] = (uint8_t)(value >> 8);
+}
+
+bool DFPongController::applyConfig(const uint8_t* data, int length) {
+    if (length != DFPONG_CONFIG_SIZE || data[0] != DFPONG_CONFIG_VERSION) {
+        debugPrint("Config rejected: wrong version or size");
+        return false;
+    }
+    
+    uint16_t interval = readUint16(&data[1]);
+    uint16_t timeout = readUint16(&data[3]);
+    uint16_t blinkSlow = readUint16(&data[5]);
+    uint16_t blinkFast = readUint16(&data[7]);
+    int rssi = (int8_t)data[9];
+    uint16_t connMin = readUint16(&data[10]);
+    uint16_t connMax = readUint16(&data[12]);
+    
+    // Range check everything before changing anything
+    if (interval < 5 || interval > 200 ||
+        timeout < 1000 || timeout > 30000 ||
+        blinkSlow < 50 || blinkSlow > 5000 ||
+        blinkFast < 20 || blinkFast > 2000 ||
+        rssi < -100 || rssi > -30 ||
+        connMin < 6 || connMax > 400 || connMin > connMax) {
+        debugPrint("Config rejected: value out of range");
+        return false;
+    }
+    
+    _notificationInterval = interval;
+    _handshakeTimeout = timeout;
+    _ledBlinkSlow = blinkSlow;
+    _ledBlinkFast = blinkFast;
+    _rssiThreshold = rssi;
+    _connIntervalMin = connMin;
+    _connIntervalMax = connMax;
+    _connIntervalTuned = true;
+    
+    debugPrint("Config applied, notification interval", interval);
+    
+    if (_persistConfig) {
+        saveConfig();
+    }
+    return true;
+}
+
+void DFPongController::encodeConfig(uint8_t* data) {
+    data[0] = DFPONG_CONFIG_VERSION;
+    writeUint16(&data[1], (uint16_t)_notificationInterval);
+    writeUint16(&data[3], (uint16_t)_handshakeTimeout);
+    writeUint16(&data[5], (uint16_t)_ledBlinkSlow);
+    writeUint16(&data[7], (uint16_t)_ledBlinkFast);
+    data[9] = (uint8_t)(int8_t)_rssiThreshold;
+    writeUint16(&data[10], _connIntervalMin);
+    writeUint16(&data[12], _connIntervalMax);
+}
+
+// Make the config characteristic read back the settings in effect
+void DFPongController::publishConfig() {
+    if (_configCharacteristic == nullptr) return;
+    
+    uint8_t data[DFPONG_CONFIG_SIZE];
+    encodeConfig(data);
+#ifdef DFPONG_USE_NIMBLE
+    _configCharacteristic->setValue(data, sizeof(data));
+#else
+    _configCharacteristic->writeValue(data, sizeof(data));
+#endif
+}
+
+// Called from the config write callback - the settings are applied
+// by serviceBLE() like the other link events
+void DFPongController::postConfig(const uint8_t* data, int length) {
+    LINK_EVENT_LOCK();
+    memcpy(_pendingConfig, data, length < DFPONG_CONFIG_SIZE ? length : DFPONG_CONFIG_SIZE);
+    _pendingConfigLength = length;
+    LINK_EVENT_UNLOCK();
+    
+    postLinkEvent(LINK_CONFIG, 0, 0);
+}
+
+void DFPongController::applyPendingConfig() {
+    uint8_t data[DFPONG_CONFIG_SIZE];
+    LINK_EVENT_LOCK();
+    memcpy(data, _pendingConfig, sizeof(data));
+    int length = _pendingConfigLength;
+    LINK_EVENT_UNLOCK();
+    
+    if (applyConfig(data, length)) {
+        applyConnectionInterval();
+    }
+    publishConfig();
+}
+
+void DFPongController::applyConnectionInterval() {
+#ifdef DFPONG_USE_NIMBLE
+    // Advertise it for the next centrals (used on the next advertising start)
+    _pAdvertising->setMinPreferred(_connIntervalMin);
+    _pAdvertising->setMaxPreferred(_connIntervalMax);
+    
+    // Renegotiate every open connection (latency 0, 4s supervision timeout).
+    // New connections ask for it in applyLinkEvent().
+    for (int i = 0; i < DFPONG_MAX_CONNECTIONS; i++) {
+        if (_connections[i].active) {
+            _pServer->updateConnParams(_connections[i].connHandle,
+                                       _connIntervalMin, _connIntervalMax, 0, 400);
         }
+    }
+#else
+    // ArduinoBLE can only change it for the next connection
+    BLE.setConnectionInterval(_connIntervalMin, _connIntervalMax);
+#endif
+}
+
+bool DFPongController::loadConfig() {
+    uint8_t data[DFPONG_CONFIG_SIZE];
+    
+#if defined(DFPONG_CONFIG_NVS)
+    Preferences prefs;
+    prefs.begin("dfpong", true);
+    size_t length = prefs.getBytes("config", data, sizeof(data));
+    prefs.end();
+    if (length != sizeof(data)) return false;
+#elif defined(DFPONG_CONFIG_EEPROM)
+    for (int i = 0; i < DFPONG_CONFIG_SIZE; i++) {
+        data[i] = EEPROM.read(DFPONG_EEPROM_ADDRESS + i);
+    }
+#else
+    return false;
+#endif
+    
+    // Validate without writing the same settings back
+    bool persist = _persistConfig;
+    _persistConfig = false;
+    bool loaded = applyConfig(data, sizeof(data));
+    _persistConfig = persist;
+    return loaded;
+}
+
+void DFPongController::saveConfig() {
+    uint8_t data[DFPONG_CONFIG_SIZE];
+    encodeConfig(data);
+    
+#if defined(DFPONG_CONFIG_NVS)
+    Preferences prefs;
+    prefs.begin("dfpong", false);
+    prefs.putBytes("config", data, sizeof(data));
+    prefs.end();
+#elif defined(DFPONG_CONFIG_EEPROM)
+    // update() skips unchanged bytes to save flash wear
+    for (int i = 0; i < DFPONG_CONFIG_SIZE; i++) {
+        EEPROM.update(DFPONG_EEPROM_ADDRESS + i, data[i]);
+    }
 #endif
+}
+
+// ============================================
+// Loop Profiler
+// ============================================
+
+void DFPongController::enableLoopProfiler(bool enabled) {
+    // Start clean, but keep the results readable after disabling
+    if (enabled && !_profileLoop) {
+        resetLoopProfiler();
+    }
+    _profileLoop = enabled;
+}
+
+void DFPongController::setStallCallback(void (*callback)(unsigned long ms)) {
+    _stallCallback = callback;
+}
+
+unsigned long DFPongController::getLoopTimeMax() {
+    return _loopTimeMax;
+}
+
+unsigned long DFPongController::getLoopTimeP99() {
+    if (_loopCount == 0) return 0;
+    
+    // Walk the histogram until 99% of loops are covered
+    unsigned long target = _loopCount - _loopCount / 100;
+    unsigned long seen = 0;
+    for (int i = 0; i < PROFILE_BUCKETS - 1; i++) {
+        seen += _loopHistogram[i];
+        if (seen >= target) {
+            return PROFILE_BUCKET_LIMITS[i];
+        }
+    }
+    return _loopTimeMax;
+}
+
+unsigned long DFPongController::getLibraryTimeMax() {
+    return _libraryTimeMax;
+}
+
+unsigned long DFPongController::getUserTimeMax() {
+    return _userTimeMax;
+}
+
+unsigned long DFPongController::getStallCount() {
+    return _stallCount;
+}
+
+void DFPongController::resetLoopProfiler() {
+    for (int i = 0; i < PROFILE_BUCKETS; i++) {
+        _loopHistogram[i] = 0;
+    }
+    _loopCount = 0;
+    _loopTimeMax = 0;
+    _libraryTimeMax = 0;
+    _userTimeMax = 0;
+    _stallCount = 0;
+    _lastUpdateStart = 0;
+    _loopLibraryTime = 0;
+}
+
+void DFPongController::printLoopProfile() {
+    Serial.println("Loop time (ms)   count");
+    unsigned long lower = 0;
+    for (int i = 0; i < PROFILE_BUCKETS; i++) {
+        Serial.print(lower / 1000);
+        if (i < PROFILE_BUCKETS - 1) {
+            Serial.print("-");
+            Serial.print(PROFILE_BUCKET_LIMITS[i] / 1000);
+            lower = PROFILE_BUCKET_LIMITS[i];
+        } else {
+            Serial.print("+");
+        }
+        Serial.print(": ");
+        Serial.println(_loopHistogram[i]);
+    }
+    
+    Serial.print("Loops: ");
+    Serial.println(_loopCount);
+    Serial.print("Max loop (us): ");
+    Serial.println(_loopTimeMax);
+    Serial.print("p99 loop (us): ");
+    Serial.println(getLoopTimeP99());
+    Serial.print("Max library (us): ");
+    Serial.println(_libraryTimeMax);
+    Serial.print("Max user code (us): ");
+    Serial.println(_userTimeMax);
+    Serial.print("Stalls: ");
+    Serial.println(_stallCount);
+}
+
+// Called at the start of update() - measures the loop that just ended
+void DFPongController::profileLoop(unsigned long updateStart) {
+    unsigned long libraryTime = _loopLibraryTime;
+    unsigned long lastStart = _lastUpdateStart;
+    _lastUpdateStart = updateStart;
+    _loopLibraryTime = 0;
+    
+    if (lastStart == 0) return;  // First loop - nothing to measure yet
+    
+    unsigned long loopTime = updateStart - lastStart;
+    unsigned long userTime = (loopTime > libraryTime) ? loopTime - libraryTime : 0;
+    
+    int bucket = 0;
+    while (bucket < PROFILE_BUCKETS - 1 && loopTime > PROFILE_BUCKET_LIMITS[bucket]) {
+        bucket++;
+    }
+    _loopHistogram[bucket]++;
+    _loopCount++;
+    
+    if (loopTime > _loopTimeMax) _loopTimeMax = loopTime;
+    if (libraryTime > _libraryTimeMax) _libraryTimeMax = libraryTime;
+    if (userTime > _userTimeMax) _userTimeMax = userTime;
+    
+    // A loop slower than the connection interval misses connection events
+    unsigned long stallLimit = (unsigned long)_connIntervalMax * 1250;
+    if (loopTime > stallLimit) {
+        unsigned long stallMs = loopTime / 1000;
+        _stallCount++;
+        traceEvent(DFPONG_TRACE_STALL, 0, stallMs > 0xFFFF ? 0xFFFF : stallMs);
+        if (_stallCallback != nullptr) {
+            _stallCallback(stallMs);
+        }
     }
 }
 
+// ============================================
+// Input Trace
+// ============================================
+
+bool DFPongController::enableTrace(int maxEvents) {
+    disableTrace();
+    if (maxEvents <= 0) return false;
+    
+    // The dump header stores the count as uint16
+    if (maxEvents > 0xFFFF) maxEvents = 0xFFFF;
+    
+    DFPongTraceEvent* buffer = (DFPongTraceEvent*)malloc(sizeof(DFPongTraceEvent) * maxEvents);
+    if (buffer == nullptr) {
+        debugPrint("Not enough memory for trace buffer");
+        return false;
+    }
+    
+    TRACE_LOCK();
+    _trace = buffer;
+    _traceCapacity = maxEvents;
+    _traceHead = 0;
+    _traceCount = 0;
+    _lastTracedDirection = -1;
+    TRACE_UNLOCK();
+    debugPrint("Trace enabled, events", maxEvents);
+    return true;
+}
+
+void DFPongController::disableTrace() {
+    // Once the ring is detached the radio task can't be writing to it
+    TRACE_LOCK();
+    DFPongTraceEvent* buffer = _trace;
+    _trace = nullptr;
+    _traceCapacity = 0;
+    _traceHead = 0;
+    _traceCount = 0;
+    _lastTracedDirection = -1;
+    TRACE_UNLOCK();
+    free(buffer);
+}
+
+void DFPongController::clearTrace() {
+    TRACE_LOCK();
+    _traceHead = 0;
+    _traceCount = 0;
+    _lastTracedDirection = -1;
+    TRACE_UNLOCK();
+}
+
+int DFPongController::getTraceLength() {
+    TRACE_LOCK();
+    int count = _traceCount;
+    TRACE_UNLOCK();
+    return count;
+}
+
+// Holds new events back so the ring stays put while it is read
+// without the lock (Serial output is too slow for a critical section).
+// Returns the number of events; the oldest is at start.
+int DFPongController::pauseTrace(int& start) {
+    TRACE_LOCK();
+    _traceDumping = true;
+    int count = _traceCount;
+    start = _traceHead - count;
+    if (start < 0) start += _traceCapacity;
+    TRACE_UNLOCK();
+    return count;
+}
+
+void DFPongController::resumeTrace() {
+    TRACE_LOCK();
+    _traceDumping = false;
+    TRACE_UNLOCK();
+}
+
+void DFPongController::dumpTrace() {
+    int start = 0;
+    int count = pauseTrace(start);
+    
+    uint8_t header[8] = {
+        'D', 'F', 'P', 'T', DFPONG_TRACE_VERSION, 0,
+        (uint8_t)(count & 0xFF), (uint8_t)(count >> 8)
+    };
+    Serial.write(header, sizeof(header));
+    
+    for (int i = 0; i < count; i++) {
+        const DFPongTraceEvent& e = _trace[(start + i) % _traceCapacity];
+        uint8_t record[8] = {
+            (uint8_t)(e.time), (uint8_t)(e.time >> 8),
+            (uint8_t)(e.time >> 16), (uint8_t)(e.time >> 24),
+            e.event, e.value,
+            (uint8_t)(e.extra & 0xFF), (uint8_t)(e.extra >> 8)
+        };
+        Serial.write(record, sizeof(record));
+    }
+    
+    resumeTrace();
+}
+
+void DFPongController::printTrace() {
+    int start = 0;
+    int count = pauseTrace(start);
+    
+    Serial.println("time,event,value,extra");
+    for (int i = 0; i < count; i++) {
+        const DFPongTraceEvent& e = _trace[(start + i) % _traceCapacity];
+        Serial.print((unsigned long)e.time);
+        Serial.print(",");
+        Serial.print((int)e.event);
+        Serial.print(",");
+        Serial.print((int)e.value);
+        Serial.print(",");
+        Serial.println((unsigned int)e.extra);
+    }
+    
+    resumeTrace();
+}
+
+// Called from the radio task as well as loop() (stall records)
+void DFPongController::traceEvent(uint8_t event, int value, int extra) {
+    uint32_t time = (uint32_t)millis();
+    
+    TRACE_LOCK();
+    if (_trace != nullptr && !_traceDumping) {
+        DFPongTraceEvent& e = _trace[_traceHead];
+        e.time = time;
+        e.event = event;
+        e.value = (uint8_t)value;
+        e.extra = (uint16_t)extra;
+        
+        // Ring buffer - overwrite the oldest event when full
+        _traceHead = (_traceHead + 1) % _traceCapacity;
+        if (_traceCount < _traceCapacity) {
+            _traceCount++;
+        }
+    }
+    TRACE_UNLOCK();
+}
+
 // ============================================
 // Connection Status
 // ============================================
@@ -435,6 +1287,36 @@ bool DFPongController::isConnected() {
 #endif
 }
 
+int DFPongController::getConnectionCount() {
+#ifdef DFPONG_USE_NIMBLE
+    int count = 0;
+    for (int i = 0; i < DFPONG_MAX_CONNECTIONS; i++) {
+        if (_connections[i].active) count++;
+    }
+    return count;
+#else
+    return isConnected() ? 1 : 0;
+#endif
+}
+
+unsigned long DFPongController::getNotifyCount(int connection) {
+#ifdef DFPONG_USE_NIMBLE
+    Connection* c = connectionAt(connection);
+    return (c != nullptr) ? c->notifySent : 0;
+#else
+    return (connection == 0 && isConnected()) ? _notifySent : 0;
+#endif
+}
+
+unsigned long DFPongController::getNotifyFailCount(int connection) {
+#ifdef DFPONG_USE_NIMBLE
+    Connection* c = connectionAt(connection);
+    return (c != nullptr) ? c->notifyFailed : 0;
+#else
+    return (connection == 0 && isConnected()) ? _notifyFailed : 0;
+#endif
+}
+
 bool DFPongController::isReady() {
 #ifdef DFPONG_USE_NIMBLE
     return _serviceStarted && _deviceConnected && _handshakeComplete;
@@ -450,10 +1332,17 @@ bool DFPongController::isReady() {
 
 int DFPongController::getRSSI() {
 #ifdef DFPONG_USE_NIMBLE
-    if (_pServer && _pServer->getConnectedCount() > 0) {
-        // NimBLE doesn't easily expose per-connection RSSI
-        // Return a placeholder - would need more complex implementation
-        return -50;  // Approximate value
+    // The game, or while it is still handshaking the
+    // first central that is not a spectator
+    Connection* game = (_gameSlot >= 0) ? &_connections[_gameSlot] : nullptr;
+    for (int i = 0; game == nullptr && i < DFPONG_MAX_CONNECTIONS; i++) {
+        Connection& c = _connections[i];
+        if (c.active && !c.spectator) game = &c;
+    }
+    
+    int8_t rssi = 0;
+    if (game != nullptr && ble_gap_conn_rssi(game->connHandle, &rssi) == 0) {
+        return rssi;
     }
     return 0;
 #else
@@ -486,14 +1375,446 @@ const char* DFPongController::getServiceUUID() {
 // State Management
 // ============================================
 
+// Shared state changes, called from applyLinkEvent().
+// Per-connection bookkeeping (NimBLE slots) happens before these.
+
+// First central connected
+void DFPongController::handleLinkUp() {
+    _deviceConnected = true;
+    _handshakeComplete = false;
+    _advertising = false;
+    _connectionStartTime = millis();
+    
+    clearSendQueue();
+    _lastSentValue = -1;
+    queueValue(HANDSHAKE);
+}
+
+// Last central disconnected
+void DFPongController::handleLinkDown() {
+    Serial.println("Waiting for connection...");
+    
+    _deviceConnected = false;
+    _advertising = false;
+    resetState();
+    
+    // Recovery time runs until the next handshake
+    _disconnectTime = millis();
+    if (_disconnectTime == 0) _disconnectTime = 1;
+}
+
+void DFPongController::handleHandshake() {
+#ifdef DFPONG_USE_NIMBLE
+    updateConnectionSummary();
+#else
+    _handshakeComplete = true;
+#endif
+    
+    unsigned long recovery = 0;
+    if (_disconnectTime != 0) {
+        recovery = millis() - _disconnectTime;
+        _disconnectTime = 0;
+        recordRecoveryTime(recovery);
+    }
+    traceEvent(DFPONG_TRACE_HANDSHAKE, HANDSHAKE, recovery > 0xFFFF ? 0xFFFF : recovery);
+    
+    debugPrint("Handshake complete!");
+    Serial.println("Controller ready to play!");
+}
+
+// Called from the BLE callbacks, which run on the NimBLE host task
+// on ESP32 - only touches the event ring and wakes the radio task
+void DFPongController::postLinkEvent(uint8_t type, uint16_t connHandle, int value) {
+    LINK_EVENT_LOCK();
+    if (_linkEventCount < LINK_EVENT_QUEUE_SIZE) {
+        LinkEvent& e = _linkEvents[(_linkEventHead + _linkEventCount) % LINK_EVENT_QUEUE_SIZE];
+        e.type = type;
+        e.connHandle = connHandle;
+        e.value = (uint16_t)value;
+        _linkEventCount++;
+    } else {
+        _linkEventLost = true;
+    }
+    LINK_EVENT_UNLOCK();
+    
+#ifdef DFPONG_USE_NIMBLE
+    // Apply it now instead of on the radio task's next period
+    if (_radioTask != nullptr) {
+        xTaskNotify(_radioTask, RADIO_NOTIFY_LINK, eSetBits);
+    }
+#endif
+}
+
+void DFPongController::applyLinkEvents() {
+    for (;;) {
+        LinkEvent e;
+        LINK_EVENT_LOCK();
+        if (_linkEventCount == 0) {
+            LINK_EVENT_UNLOCK();
+            break;
+        }
+        e = _linkEvents[_linkEventHead];
+        _linkEventHead = (_linkEventHead + 1) % LINK_EVENT_QUEUE_SIZE;
+        _linkEventCount--;
+        LINK_EVENT_UNLOCK();
+        
+        applyLinkEvent(e);
+    }
+    
+    if (_linkEventLost) {
+        _linkEventLost = false;
+        invariantViolated(INVARIANT_LINK_EVENT_LOST);
+    }
+}
+
+void DFPongController::applyLinkEvent(const LinkEvent& event) {
+#ifdef DFPONG_USE_NIMBLE
+    Connection* c = nullptr;
+    
+    switch (event.type) {
+    case LINK_CONNECTED:
+        // Claim a free connection slot
+        c = findConnection(BLE_HS_CONN_HANDLE_NONE);
+        if (c == nullptr) {
+            _pServer->disconnect(event.connHandle);
+            return;
+        }
+        c->active = true;
+        c->connHandle = event.connHandle;
+        c->subscribed = false;
+        c->handshakeComplete = false;
+        c->timedOut = false;
+        c->spectator = false;
+        c->lastSentValue = -1;
+        c->lastNotificationTime = 0;
+        c->connectionStartTime = millis();
+        c->notifySent = 0;
+        c->notifyFailed = 0;
+        
+        // Ask for the tuned interval once the game host has set one
+        if (_connIntervalTuned) {
+            _pServer->updateConnParams(c->connHandle, _connIntervalMin, _connIntervalMax, 0, 400);
+        }
+        
+        // First central - start fresh shared state
+        if (!_deviceConnected) {
+            handleLinkUp();
+        }
+        updateConnectionSummary();
+        traceEvent(DFPONG_TRACE_CONNECTED, 0, getConnectionCount());
+        break;
+        
+    case LINK_DISCONNECTED:
+        c = findConnection(event.connHandle);
+        if (c != nullptr) {
+            c->active = false;
+            c->connHandle = BLE_HS_CONN_HANDLE_NONE;
+            if (_gameSlot >= 0 && c == &_connections[_gameSlot]) {
+                _gameSlot = -1;
+                
+                // Recovery time runs until the next game handshake,
+                // even while spectators stay connected
+                _disconnectTime = millis();
+                if (_disconnectTime == 0) _disconnectTime = 1;
+            }
+        }
+        updateConnectionSummary();
+        traceEvent(DFPONG_TRACE_DISCONNECTED, event.value, getConnectionCount());
+        
+        // Only reset shared state once the last central has left
+        if (!_deviceConnected) {
+            handleLinkDown();
+        }
+        break;
+        
+    case LINK_HANDSHAKE:
+        c = findConnection(event.connHandle);
+        if (c == nullptr || c->handshakeComplete) return;
+        
+        c->handshakeComplete = true;
+        
+        // The first HANDSHAKE is the game, everything else spectates
+        if (event.value == HANDSHAKE && _gameSlot < 0) {
+            _gameSlot = c - _connections;
+            handleHandshake();
+        } else {
+            c->spectator = true;
+            traceEvent(DFPONG_TRACE_HANDSHAKE, SPECTATOR_HANDSHAKE, 0);
+            debugPrint("Spectator connected");
+        }
+        break;
+        
+    case LINK_SUBSCRIBED:
+        c = findConnection(event.connHandle);
+        if (c != nullptr) {
+            c->subscribed = (event.value != 0);
+        }
+        break;
+        
+    case LINK_CONFIG:
+        applyPendingConfig();
+        break;
+    }
+#else
+    switch (event.type) {
+    case LINK_CONNECTED:
+        // Reset state for new connection
+        handleLinkUp();
+        _handshakeTimedOut = false;
+        traceEvent(DFPONG_TRACE_CONNECTED, 0, 1);
+        _notifySent = 0;
+        _notifyFailed = 0;
+        break;
+        
+    case LINK_DISCONNECTED:
+        // Reset all state
+        traceEvent(DFPONG_TRACE_DISCONNECTED, 0, 0);
+        handleLinkDown();
+        
+        // Ensure clean advertising restart - update() advertises again
+        // after ADVERTISING_RESTART_DELAY instead of blocking here
+        BLE.stopAdvertise();
+        break;
+        
+    case LINK_HANDSHAKE:
+        handleHandshake();
+        break;
+        
+    case LINK_CONFIG:
+        applyPendingConfig();
+        break;
+    }
+#endif
+}
+
+// Only counts and traces - the state is left as it is so the
+// trace shows what went wrong. Each violation counts once, when it
+// starts, not on every update() it persists.
+void DFPongController::checkInvariants() {
+    uint8_t violated = 0;
+    
+#ifndef DFPONG_USE_NIMBLE
+    // Disconnect event never arrived
+    if (_deviceConnected && !BLE.connected()) {
+        violated |= 1 << INVARIANT_MISSED_DISCONNECT;
+    }
+#endif
+    
+    // Ready implies connected
+    if (_handshakeComplete && !_deviceConnected) {
+        violated |= 1 << INVARIANT_HANDSHAKE_WITHOUT_LINK;
+    }
+    
+    // Nothing may be queued without a connection
+    if (!_deviceConnected && _sendQueueCount > 0) {
+        violated |= 1 << INVARIANT_QUEUE_WITHOUT_LINK;
+    }
+    
+    for (int i = INVARIANT_MISSED_DISCONNECT; i <= INVARIANT_QUEUE_WITHOUT_LINK; i++) {
+        if ((violated & ~_activeInvariants) & (1 << i)) {
+            invariantViolated(i);
+        }
+    }
+    _activeInvariants = violated;
+}
+
+void DFPongController::checkAdvertising() {
+#ifdef DFPONG_USE_NIMBLE
+    if (getConnectionCount() >= _maxConnections || _pAdvertising->isAdvertising()) {
+        _advertising = true;
+        return;
+    }
+    
+    // Callbacks restart advertising right away, so still not
+    // advertising after ADVERTISING_RESTART_DELAY means it was lost
+    if (_advertising) {
+        _advertising = false;
+        _advertisingLostTime = millis();
+        return;
+    }
+    if (millis() - _advertisingLostTime < ADVERTISING_RESTART_DELAY) return;
+    
+    invariantViolated(INVARIANT_NOT_ADVERTISING);
+    NimBLEDevice::startAdvertising();
+    _advertising = true;
+#else
+    if (_deviceConnected || _advertising) return;
+    
+    // Give the stack a moment after a disconnect
+    if (millis() - _disconnectTime < ADVERTISING_RESTART_DELAY) return;
+    
+    BLE.advertise();
+    _advertising = true;
+#endif
+}
+
+void DFPongController::invariantViolated(int invariant) {
+    _invariantViolations++;
+    traceEvent(DFPONG_TRACE_INVARIANT, invariant, 0);
+    debugPrint("Connection state inconsistent, invariant", invariant);
+}
+
+void DFPongController::recordRecoveryTime(unsigned long ms) {
+    int bucket = 0;
+    while (bucket < RECOVERY_BUCKETS - 1 && ms > RECOVERY_BUCKET_LIMITS[bucket]) {
+        bucket++;
+    }
+    _recoveryHistogram[bucket]++;
+    _lastRecoveryTime = ms;
+    if (ms > _recoveryTimeMax) _recoveryTimeMax = ms;
+    
+    debugPrint("Recovered after ms", (int)ms);
+}
+
+unsigned long DFPongController::getLastRecoveryTime() {
+    return _lastRecoveryTime;
+}
+
+unsigned long DFPongController::getRecoveryTimeMax() {
+    return _recoveryTimeMax;
+}
+
+unsigned long DFPongController::getInvariantViolationCount() {
+    return _invariantViolations;
+}
+
+void DFPongController::printRecoveryProfile() {
+    Serial.println("Recovery time (ms)   count");
+    unsigned long lower = 0;
+    for (int i = 0; i < RECOVERY_BUCKETS; i++) {
+        Serial.print(lower);
+        if (i < RECOVERY_BUCKETS - 1) {
+            Serial.print("-");
+            Serial.print(RECOVERY_BUCKET_LIMITS[i]);
+            lower = RECOVERY_BUCKET_LIMITS[i];
+        } else {
+            Serial.print("+");
+        }
+        Serial.print(": ");
+        Serial.println(_recoveryHistogram[i]);
+    }
+    
+    Serial.print("Last recovery (ms): ");
+    Serial.println(_lastRecoveryTime);
+    Serial.print("Max recovery (ms): ");
+    Serial.println(_recoveryTimeMax);
+    Serial.print("Invariant violations: ");
+    Serial.println(_invariantViolations);
+}
+
 void DFPongController::resetState() {
+    // Anything still queued never reached the game
+    if (_sendQueueCount > 0) {
+        _sendDropCount += _sendQueueCount;
+        traceEvent(DFPONG_TRACE_DROPPED, 0, _sendQueueCount);
+    }
+    clearSendQueue();
+    
     _handshakeComplete = false;
     _lastSentValue = 0;
-    _valueChanged = false;
     _lastNotificationTime = 0;
     _connectionStartTime = 0;
 }
 
+#ifdef DFPONG_USE_NIMBLE
+
+// Pass BLE_HS_CONN_HANDLE_NONE to find a free slot
+DFPongController::Connection* DFPongController::findConnection(uint16_t connHandle) {
+    for (int i = 0; i < _maxConnections; i++) {
+        Connection& c = _connections[i];
+        if (connHandle == BLE_HS_CONN_HANDLE_NONE ? !c.active : (c.active && c.connHandle == connHandle)) {
+            return &c;
+        }
+    }
+    return nullptr;
+}
+
+// Index counts connected centrals only, in slot order
+DFPongController::Connection* DFPongController::connectionAt(int index) {
+    for (int i = 0; i < DFPONG_MAX_CONNECTIONS; i++) {
+        if (!_connections[i].active) continue;
+        if (index == 0) return &_connections[i];
+        index--;
+    }
+    return nullptr;
+}
+
+// Shared flags summarize all connections:
+// connected = any central, handshake = the game is ready
+void DFPongController::updateConnectionSummary() {
+    bool connected = false;
+    for (int i = 0; i < DFPONG_MAX_CONNECTIONS; i++) {
+        if (_connections[i].active) connected = true;
+    }
+    _deviceConnected = connected;
+    _handshakeComplete = _gameSlot >= 0 &&
+                         _connections[_gameSlot].active &&
+                         _connections[_gameSlot].handshakeComplete;
+}
+
+// ============================================
+// Radio Task (ESP32 only)
+// ============================================
+
+bool DFPongController::startRadioTask() {
+    if (_radioTask != nullptr) return true;
+    
+    // Same core as the NimBLE host so notifications are not
+    // delayed by cross-core hand-offs
+    BaseType_t created = xTaskCreatePinnedToCore(
+        radioTaskMain, "dfpong_radio", RADIO_TASK_STACK, this,
+        RADIO_TASK_PRIORITY, &_radioTask, CONFIG_BT_NIMBLE_PINNED_TO_CORE
+    );
+    if (created != pdPASS) {
+        _radioTask = nullptr;
+        return false;
+    }
+    
+    debugPrint("Radio task started on core", CONFIG_BT_NIMBLE_PINNED_TO_CORE);
+    return true;
+}
+
+// Called from loop() - never blocks. Only the latest direction
+// matters, so a single slot is enough.
+void DFPongController::publishControl(int direction) {
+    // Validate direction (-1 marks an empty mailbox)
+    if (direction < 0 || direction > 2) {
+        direction = NEUTRAL;
+    }
+    if (direction == _publishedDirection) return;
+    _publishedDirection = direction;
+    
+    _mailbox.store(direction, std::memory_order_release);
+    xTaskNotify(_radioTask, RADIO_NOTIFY_CONTROL, eSetBits);
+}
+
+void DFPongController::radioTaskMain(void* arg) {
+    DFPongController* self = (DFPongController*)arg;
+    
+    for (;;) {
+        // Wake on a new direction or link event, or often enough
+        // for pacing, retries, the handshake timeout and LED state
+        uint32_t bits = 0;
+        xTaskNotifyWait(0, 0xFFFFFFFF, &bits, pdMS_TO_TICKS(RADIO_TASK_PERIOD));
+        
+        if (bits & RADIO_NOTIFY_CONTROL) {
+            int direction = self->_mailbox.exchange(-1, std::memory_order_acquire);
+            if (direction >= 0) {
+                self->_radioDirection = direction;
+            }
+        }
+        
+        // Keep offering the held direction so it goes out as soon
+        // as the handshake completes or pacing allows
+        if (self->_radioDirection >= 0) {
+            self->processControl(self->_radioDirection);
+        }
+        self->serviceBLE();
+    }
+}
+
+#endif // DFPONG_USE_NIMBLE
+
 // ============================================
 // Debug Helpers
 // ============================================
@@ -524,17 +1845,7 @@ void DFPongController::onBLEConnected(BLEDevice central) {
     Serial.print("Connected to: ");
     Serial.println(central.address());
     
-    // Reset state for new connection
-    _instance->_deviceConnected = true;
-    _instance->_handshakeComplete = false;
-    _instance->_lastSentValue = HANDSHAKE;
-    _instance->_valueChanged = true;
-    _instance->_connectionStartTime = millis();
-    
-    // LED solid during handshake (updateLED will handle blinking)
-    if (_instance->_statusLedPin >= 0) {
-        digitalWrite(_instance->_statusLedPin, HIGH);
-    }
+    _instance->postLinkEvent(LINK_CONNECTED, 0, 0);
 }
 
 void DFPongController::onBLEDisconnected(BLEDevice central) {
@@ -542,16 +1853,8 @@ void DFPongController::onBLEDisconnected(BLEDevice central) {
     
     Serial.print("Disconnected from: ");
     Serial.println(central.address());
-    Serial.println("Waiting for connection...");
-    
-    // Reset all state
-    _instance->_deviceConnected = false;
-    _instance->resetState();
     
-    // Ensure clean advertising restart
-    BLE.stopAdvertise();
-    delay(50);
-    BLE.advertise();
+    _instance->postLinkEvent(LINK_DISCONNECTED, 0, 0);
 }
 
 void DFPongController::onCharacteristicWritten(BLEDevice central, BLECharacteristic characteristic) {
@@ -560,10 +1863,20 @@ void DFPongController::onCharacteristicWritten(BLEDevice central, BLECharacteris
     byte value = _instance->_movementCharacteristic->value();
     
     if (value == HANDSHAKE) {
-        _instance->_handshakeComplete = true;
-        _instance->debugPrint("Handshake complete!");
-        Serial.println("Controller ready to play!");
+        _instance->postLinkEvent(LINK_HANDSHAKE, 0, 0);
     }
 }
 
+void DFPongController::onConfigWritten(BLEDevice central, BLECharacteristic characteristic) {
+    if (_instance == nullptr) return;
+    
+    // Variable length, so a short write is rejected instead of
+    // being padded with the previous value
+    int length = characteristic.valueLength();
+    uint8_t data[DFPONG_CONFIG_SIZE];
+    characteristic.readValue(data, sizeof(data));
+    
+    _instance->postConfig(data, length);
+}
+
 #endif // !DFPONG_USE_NIMBLE
@@ -18,6 +18,7 @@
 #define DF_PONG_CONTROLLER_H
 
 #include <Arduino.h>
+#include "DFPongStatusLED.h"
 
 // ============================================
 // Platform Detection
@@ -25,11 +26,27 @@
 #if defined(ESP32)
     #define DFPONG_USE_NIMBLE
     #include <NimBLEDevice.h>
+    #include <atomic>
+    
+    // Upper limit for setMaxConnections()
+    #ifndef DFPONG_MAX_CONNECTIONS
+        #define DFPONG_MAX_CONNECTIONS CONFIG_BT_NIMBLE_MAX_CONNECTIONS
+    #endif
 #else
     #define DFPONG_USE_ARDUINOBLE
     #include <ArduinoBLE.h>
 #endif
 
+// Where enableRemoteConfig(true) stores settings
+#if defined(ESP32)
+    #define DFPONG_CONFIG_NVS         // Preferences (NVS flash)
+#elif defined(ARDUINO_ARCH_RENESAS)
+    #define DFPONG_CONFIG_EEPROM      // UNO R4 emulated EEPROM
+    #ifndef DFPONG_EEPROM_ADDRESS
+        #define DFPONG_EEPROM_ADDRESS 0
+    #endif
+#endif
+
 // ============================================
 // Direction Constants
 // Use these with sendControl()
@@ -42,6 +59,56 @@ const int DOWN = 2;       // Paddle moves down
 // Internal Constants (do not modify)
 // ============================================
 const int HANDSHAKE = 3;  // Connection handshake signal
+const int SPECTATOR_HANDSHAKE = 4;  // Handshake from an extra central (never the game)
+
+// ============================================
+// Remote Config Format
+// Written to the config characteristic (enableRemoteConfig())
+// ============================================
+//
+// 14 bytes, little endian:
+//   [0]      version (DFPONG_CONFIG_VERSION)
+//   [1..2]   notification interval ms      (5 - 200)
+//   [3..4]   handshake timeout ms          (1000 - 30000)
+//   [5..6]   LED slow blink ms             (50 - 5000)
+//   [7..8]   LED fast blink ms             (20 - 2000)
+//   [9]      RSSI threshold dBm, signed    (-100 - -30)
+//   [10..11] connection interval min, 1.25 ms units (6 - 400)
+//   [12..13] connection interval max, 1.25 ms units (min - 400)
+//
+// Writes with another version, length or out-of-range value
+// are rejected as a whole.
+const uint8_t DFPONG_CONFIG_VERSION = 1;
+const int DFPONG_CONFIG_SIZE = 14;
+
+// ============================================
+// Trace Format
+// Used by enableTrace() / dumpTrace()
+// ============================================
+
+// Event codes stored in DFPongTraceEvent::event
+const uint8_t DFPONG_TRACE_SEND_CONTROL = 1;       // value = requested direction
+const uint8_t DFPONG_TRACE_CONNECTED = 2;          // central connected
+const uint8_t DFPONG_TRACE_DISCONNECTED = 3;       // value = reason (NimBLE only)
+const uint8_t DFPONG_TRACE_HANDSHAKE = 4;          // handshake complete
+const uint8_t DFPONG_TRACE_HANDSHAKE_TIMEOUT = 5;  // gave up waiting for handshake
+const uint8_t DFPONG_TRACE_NOTIFY_OK = 6;          // value = sent value, extra = queue depth
+const uint8_t DFPONG_TRACE_NOTIFY_FAILED = 7;      // value = value being retried
+const uint8_t DFPONG_TRACE_DROPPED = 8;            // extra = number of values dropped
+const uint8_t DFPONG_TRACE_STALL = 9;              // extra = loop period in ms
+const uint8_t DFPONG_TRACE_INVARIANT = 10;         // value = violated invariant
+
+// Dump header: "DFPT", version, reserved byte, uint16 record count,
+// followed by the records. All fields are little endian.
+const uint8_t DFPONG_TRACE_VERSION = 1;
+
+// One 8-byte trace record
+struct DFPongTraceEvent {
+    uint32_t time;   // Library clock in ms
+    uint8_t event;   // DFPONG_TRACE_* code
+    uint8_t value;   // Event specific
+    uint16_t extra;  // Event specific
+};
 
 // ============================================
 // DFPongController Class
@@ -74,6 +141,15 @@ public:
      */
     void setStatusLED(int pin);
     
+    /**
+     * Show signal strength on the status LED when ready to play:
+     * 1-4 short flashes instead of solid ON.
+     * 1 = below the RSSI threshold, 4 = excellent.
+     * 
+     * @param enabled true to show signal strength
+     */
+    void setSignalLED(bool enabled);
+    
     /**
      * Enable/disable debug messages to Serial.
      * 
@@ -81,6 +157,45 @@ public:
      */
     void setDebug(bool enabled);
     
+    /**
+     * Allow more than one central to connect at the same time,
+     * e.g. the game plus a scoreboard or logging laptop.
+     * Every central gets its own handshake and the same controls.
+     * The first central to write HANDSHAKE is the game: isReady(),
+     * the LED and getRSSI() follow that connection only. Extra
+     * centrals should write SPECTATOR_HANDSHAKE instead.
+     * ESP32 only - other boards always allow 1 connection.
+     * 
+     * @param count Number of centrals (1 to DFPONG_MAX_CONNECTIONS, default 1)
+     */
+    void setMaxConnections(int count);
+    
+    /**
+     * Add a writable config characteristic so the game host can
+     * tune pacing, timeouts, LED blink rates, the RSSI threshold and
+     * the connection interval at connect time.
+     * Call before begin().
+     * 
+     * @param persist true to save accepted settings and load them
+     *                again on begin() (ESP32 and UNO R4 only)
+     */
+    void enableRemoteConfig(bool persist);
+    
+    /**
+     * Same as enableRemoteConfig(false).
+     */
+    void enableRemoteConfig();
+    
+    /**
+     * Run the Bluetooth work in its own task instead of loop().
+     * sendControl() then only hands the direction over, so slow
+     * sensor code in loop() no longer delays notifications.
+     * ESP32 only. Call before begin().
+     * 
+     * @param enabled true to use the radio task
+     */
+    void useRadioTask(bool enabled);
+    
     // ----------------------------------------
     // Initialization
     // ----------------------------------------
@@ -122,6 +237,146 @@ public:
      */
     void sendControl(int direction);
     
+    // ----------------------------------------
+    // Send Queue Diagnostics
+    // ----------------------------------------
+    
+    /**
+     * Get the number of values waiting to be sent.
+     * A depth that stays above 0 means the link is stalled.
+     * 
+     * @return Number of queued values (0 when everything was sent)
+     */
+    int getSendQueueDepth();
+    
+    /**
+     * Get how many times a failed send was retried.
+     * 
+     * @return Total retries since begin()
+     */
+    unsigned long getSendRetryCount();
+    
+    /**
+     * Get how many queued values were dropped without being sent
+     * (queue overflow or disconnect before delivery).
+     * 
+     * @return Total dropped values since begin()
+     */
+    unsigned long getSendDropCount();
+    
+    // ----------------------------------------
+    // Loop Profiler (advanced)
+    // ----------------------------------------
+    
+    /**
+     * Measure how long each loop() takes, split into time spent
+     * inside the library (update() and sendControl()) and time spent
+     * in your own code. A loop slower than the BLE connection
+     * interval counts as a stall.
+     * Starting clears old results; stopping keeps them readable.
+     * 
+     * @param enabled true to start measuring, false to stop
+     */
+    void enableLoopProfiler(bool enabled);
+    
+    /**
+     * Call a function of yours whenever loop() stalls.
+     * Example: void onStall(unsigned long ms) { ... }
+     * 
+     * @param callback Function that receives the loop time in ms
+     */
+    void setStallCallback(void (*callback)(unsigned long ms));
+    
+    /**
+     * Get the longest loop() time measured.
+     * 
+     * @return Loop time in microseconds
+     */
+    unsigned long getLoopTimeMax();
+    
+    /**
+     * Get the loop() time that 99% of loops stay under
+     * (rounded up to the histogram bucket).
+     * 
+     * @return Loop time in microseconds
+     */
+    unsigned long getLoopTimeP99();
+    
+    /**
+     * Get the longest time spent inside the library in one loop().
+     * 
+     * @return Time in microseconds
+     */
+    unsigned long getLibraryTimeMax();
+    
+    /**
+     * Get the longest time spent in your own code in one loop().
+     * 
+     * @return Time in microseconds
+     */
+    unsigned long getUserTimeMax();
+    
+    /**
+     * Get how many loops were slower than the connection interval.
+     * 
+     * @return Number of stalls since the profiler was reset
+     */
+    unsigned long getStallCount();
+    
+    /**
+     * Clear all profiler measurements.
+     */
+    void resetLoopProfiler();
+    
+    /**
+     * Print the loop time histogram and maximums to Serial.
+     */
+    void printLoopProfile();
+    
+    // ----------------------------------------
+    // Input Trace (advanced)
+    // ----------------------------------------
+    
+    /**
+     * Start recording a trace of control changes, connection
+     * events and send results into a RAM ring buffer.
+     * When the buffer is full the oldest events are overwritten.
+     * 
+     * @param maxEvents Ring size in events (8 bytes each, at most 65535)
+     * @return true if the buffer could be allocated
+     */
+    bool enableTrace(int maxEvents);
+    
+    /**
+     * Stop recording and free the trace buffer.
+     */
+    void disableTrace();
+    
+    /**
+     * Remove all recorded events (keeps recording).
+     */
+    void clearTrace();
+    
+    /**
+     * Get the number of events currently recorded.
+     * 
+     * @return Number of events in the trace buffer
+     */
+    int getTraceLength();
+    
+    /**
+     * Write the trace to Serial in the binary trace format
+     * (see DFPongTraceEvent), oldest event first.
+     * Capture it on the computer to save it as a file.
+     */
+    void dumpTrace();
+    
+    /**
+     * Print the trace to Serial as readable CSV lines:
+     * time,event,value,extra
+     */
+    void printTrace();
+    
     // ----------------------------------------
     // Connection Status
     // ----------------------------------------
@@ -141,6 +396,29 @@ public:
      */
     bool isReady();
     
+    /**
+     * Get the number of connected centrals.
+     * 
+     * @return Number of connections (0 when disconnected)
+     */
+    int getConnectionCount();
+    
+    /**
+     * Get how many notifications were delivered to a connection.
+     * 
+     * @param connection Connection index (0 to getConnectionCount() - 1)
+     * @return Notifications sent since that central connected
+     */
+    unsigned long getNotifyCount(int connection);
+    
+    /**
+     * Get how many notifications failed for a connection.
+     * 
+     * @param connection Connection index (0 to getConnectionCount() - 1)
+     * @return Failed notifications since that central connected
+     */
+    unsigned long getNotifyFailCount(int connection);
+    
     // ----------------------------------------
     // Signal Strength
     // ----------------------------------------
@@ -186,6 +464,39 @@ public:
      * @return The BLE service UUID string
      */
     const char* getServiceUUID();
+    
+    // ----------------------------------------
+    // Reconnect Diagnostics (advanced)
+    // ----------------------------------------
+    
+    /**
+     * Get the time from the last disconnect until the game
+     * completed the handshake again.
+     * 
+     * @return Recovery time in ms (0 if not reconnected yet)
+     */
+    unsigned long getLastRecoveryTime();
+    
+    /**
+     * Get the longest recovery time since begin().
+     * 
+     * @return Recovery time in ms
+     */
+    unsigned long getRecoveryTimeMax();
+    
+    /**
+     * Get how often the connection state was found inconsistent
+     * (e.g. a missed disconnect event). Each problem counts once
+     * when it appears; the trace records which invariant it was.
+     * 
+     * @return Number of violations since begin()
+     */
+    unsigned long getInvariantViolationCount();
+    
+    /**
+     * Print the recovery time histogram to Serial.
+     */
+    void printRecoveryProfile();
 
 private:
     // Configuration
@@ -199,42 +510,215 @@ private:
     NimBLEServer* _pServer;
     NimBLEService* _pongService;
     NimBLECharacteristic* _movementCharacteristic;
+    NimBLECharacteristic* _configCharacteristic;
     NimBLEAdvertising* _pAdvertising;
+    
+    // Per-connection state, one slot per connected central
+    struct Connection {
+        bool active;
+        uint16_t connHandle;
+        bool subscribed;
+        bool handshakeComplete;
+        bool timedOut;           // Handshake timeout already handled
+        bool spectator;          // Wrote SPECTATOR_HANDSHAKE, never the game
+        int lastSentValue;
+        unsigned long lastNotificationTime;  // Pacing is per central
+        unsigned long connectionStartTime;
+        unsigned long notifySent;
+        unsigned long notifyFailed;
+    };
+    Connection _connections[DFPONG_MAX_CONNECTIONS];
+    int _maxConnections;
+    int _gameSlot;               // Slot of the game, -1 until it handshakes
+    
+    // Radio task (useRadioTask())
+    bool _useRadioTask;
+    TaskHandle_t _radioTask;
+    std::atomic<int> _mailbox;   // Latest direction, -1 = empty
+    int _publishedDirection;     // loop() side
+    int _radioDirection;         // Radio task side
+    static const uint32_t RADIO_TASK_STACK = 4096;
+    static const UBaseType_t RADIO_TASK_PRIORITY = 5;
+    static const uint32_t RADIO_TASK_PERIOD = 5;  // ms
+    static const uint32_t RADIO_NOTIFY_CONTROL = 1 << 0;  // New direction in the mailbox
+    static const uint32_t RADIO_NOTIFY_LINK = 1 << 1;     // Link event posted
 #else
     BLEService* _pongService;
     BLEByteCharacteristic* _movementCharacteristic;
+    BLECharacteristic* _configCharacteristic;
+    
+    // Delivery stats for the single connection
+    unsigned long _notifySent;
+    unsigned long _notifyFailed;
+    bool _handshakeTimedOut;     // Timeout already handled for this connection
 #endif
     
     // UUID storage
     char _serviceUuid[37];
     char _characteristicUuid[37];
+    char _configUuid[37];
     
     // State tracking
     bool _serviceStarted;
+#ifdef DFPONG_USE_NIMBLE
+    // Written by the radio task, read by isReady()/isConnected() in loop()
+    std::atomic<bool> _handshakeComplete;
+    std::atomic<bool> _deviceConnected;
+#else
     bool _handshakeComplete;
-    bool _ledState;
-    int _lastSentValue;
-    bool _valueChanged;
     bool _deviceConnected;
+#endif
+    DFPongStatusLED _led;
+    bool _ledShowSignal;
+    bool _ledError;
+    int _signalBars;
+    int _lastSentValue;
+    
+    // Link events - the BLE callbacks only post these and
+    // serviceBLE() applies them, so connection state and the send
+    // queue are only ever changed by the task that sends
+    static const uint8_t LINK_CONNECTED = 1;
+    static const uint8_t LINK_DISCONNECTED = 2;     // value = reason
+    static const uint8_t LINK_HANDSHAKE = 3;
+    static const uint8_t LINK_SUBSCRIBED = 4;       // value = subscription bits
+    static const uint8_t LINK_CONFIG = 5;           // _pendingConfig was written
+    struct LinkEvent {
+        uint8_t type;
+        uint16_t connHandle;
+        uint16_t value;
+    };
+    static const int LINK_EVENT_QUEUE_SIZE = 16;
+    LinkEvent _linkEvents[LINK_EVENT_QUEUE_SIZE];
+    volatile int _linkEventHead;
+    volatile int _linkEventCount;
+    volatile bool _linkEventLost;
+    uint8_t _pendingConfig[DFPONG_CONFIG_SIZE];
+    int _pendingConfigLength;
+    
+    // Send queue - directions are latest-value-wins,
+    // HANDSHAKE messages keep their order
+    static const int SEND_QUEUE_SIZE = 4;
+    uint8_t _sendQueue[SEND_QUEUE_SIZE];
+    int _sendQueueHead;
+    int _sendQueueCount;
+    unsigned long _sendRetryCount;
+    unsigned long _sendDropCount;
+    
+    // Trace ring buffer. The radio task and loop() both trace,
+    // so everything here is changed under the trace lock.
+    DFPongTraceEvent* _trace;
+    int _traceCapacity;
+    int _traceHead;
+    int _traceCount;
+    int _lastTracedDirection;
+    bool _traceDumping;          // Dump in progress - new events are dropped
+    
+    // Reconnect tracking
+    bool _advertising;
+    unsigned long _advertisingLostTime;
+    unsigned long _disconnectTime;
+    unsigned long _invariantViolations;
+    uint8_t _activeInvariants;   // Bit per invariant currently violated
+    static const int RECOVERY_BUCKETS = 8;
+    static const unsigned long RECOVERY_BUCKET_LIMITS[RECOVERY_BUCKETS - 1];
+    unsigned long _recoveryHistogram[RECOVERY_BUCKETS];
+    unsigned long _lastRecoveryTime;
+    unsigned long _recoveryTimeMax;
+    
+    // Invariants checked every update()
+    static const int INVARIANT_MISSED_DISCONNECT = 1;       // Connected flag without a link
+    static const int INVARIANT_HANDSHAKE_WITHOUT_LINK = 2;  // Ready while disconnected
+    static const int INVARIANT_QUEUE_WITHOUT_LINK = 3;      // Values queued while disconnected
+    static const int INVARIANT_NOT_ADVERTISING = 4;         // Free slot but not advertising
+    static const int INVARIANT_LINK_EVENT_LOST = 5;         // Link event queue overflowed
+    
+    // Loop profiler (times in microseconds)
+    static const int PROFILE_BUCKETS = 11;
+    static const unsigned long PROFILE_BUCKET_LIMITS[PROFILE_BUCKETS - 1];
+    bool _profileLoop;
+    void (*_stallCallback)(unsigned long ms);
+    unsigned long _loopHistogram[PROFILE_BUCKETS];
+    unsigned long _loopCount;
+    unsigned long _loopTimeMax;
+    unsigned long _libraryTimeMax;
+    unsigned long _userTimeMax;
+    unsigned long _stallCount;
+    unsigned long _lastUpdateStart;
+    unsigned long _loopLibraryTime;
     
     // Timing
-    unsigned long _lastLedToggle;
+    unsigned long _lastSignalCheck;
     unsigned long _lastNotificationTime;
     unsigned long _connectionStartTime;
     
-    // Constants
+    // Tunable settings (see Remote Config Format)
+    bool _remoteConfig;
+    bool _persistConfig;
+    unsigned long _ledBlinkSlow;
+    unsigned long _ledBlinkFast;
+    unsigned long _notificationInterval;
+    unsigned long _handshakeTimeout;
+    uint16_t _connIntervalMin;
+    uint16_t _connIntervalMax;
+    bool _connIntervalTuned;  // Written or loaded - until then advertise the defaults
+    
+    // Defaults
     static const unsigned long LED_BLINK_SLOW = 500;
     static const unsigned long LED_BLINK_FAST = 100;
     static const unsigned long MIN_NOTIFICATION_INTERVAL = 20;
     static const unsigned long HANDSHAKE_TIMEOUT = 5000;
+    static const uint16_t CONN_INTERVAL_MIN = 12;   // 15ms
+    static const uint16_t CONN_INTERVAL_MAX = 24;   // 30ms
+    static const unsigned long SIGNAL_CHECK_INTERVAL = 1000;
+    static const unsigned long ADVERTISING_RESTART_DELAY = 50;
     
     // Manufacturer data for device identification
     static const uint8_t MANUFACTURER_DATA[2];
     
     // Private methods
     void generateUUIDs();
+    void serviceBLE();
+    void processControl(int direction);
     void updateLED();
+    void updateSignalBars();
+    void showError();
     void resetState();
+    void handleLinkUp();
+    void handleLinkDown();
+    void handleHandshake();
+    void postLinkEvent(uint8_t type, uint16_t connHandle, int value);
+    void applyLinkEvents();
+    void applyLinkEvent(const LinkEvent& event);
+    void postConfig(const uint8_t* data, int length);
+    void applyPendingConfig();
+    void checkInvariants();
+    void checkAdvertising();
+    void invariantViolated(int invariant);
+    void recordRecoveryTime(unsigned long ms);
+    void queueValue(int value);
+    void flushSendQueue();
+    void clearSendQueue();
+    void traceEvent(uint8_t event, int value, int extra);
+    int pauseTrace(int& start);
+    void resumeTrace();
+    void profileLoop(unsigned long updateStart);
+    bool applyConfig(const uint8_t* data, int length);
+    void encodeConfig(uint8_t* data);
+    void publishConfig();
+    void applyConnectionInterval();
+    bool loadConfig();
+    void saveConfig();
+#ifdef DFPONG_USE_NIMBLE
+    bool transmitValue(int value, uint16_t connHandle);
+    Connection* findConnection(uint16_t connHandle);
+    Connection* connectionAt(int index);
+    void updateConnectionSummary();
+    bool startRadioTask();
+    void publishControl(int direction);
+    static void radioTaskMain(void* arg);
+#else
+    bool transmitValue(int value);
+#endif
     void debugPrint(const char* message);
     void debugPrint(const char* message, int value);
     
@@ -245,12 +729,15 @@ private:
     // NimBLE callback classes
     class ServerCallbacks;
     class CharacteristicCallbacks;
+    class ConfigCallbacks;
     friend class ServerCallbacks;
     friend class CharacteristicCallbacks;
+    friend class ConfigCallbacks;
 #else
     static void onBLEConnected(BLEDevice central);
     static void onBLEDisconnected(BLEDevice central);
     static void onCharacteristicWritten(BLEDevice central, BLECharacteristic characteristic);
+    static void onConfigWritten(BLEDevice central, BLECharacteristic characteristic);
 #endif
 };
 
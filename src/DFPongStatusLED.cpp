@@ -0,0 +1,233 @@
+/*
+ * DFPongStatusLED.cpp
+ *
+ * Timer-driven status LED patterns for DFPongController.
+ *
+ * Created by Digital Futures OCAD U
+ * MIT License
+ */
+
+#include "DFPongStatusLED.h"
+
+#if defined(DFPONG_NO_LED_TIMER)
+    // Timer backends disabled - the pattern is stepped from update()
+#elif defined(ESP32)
+    #include "esp_timer.h"
+#elif defined(ARDUINO_ARCH_RENESAS)
+    #include "FspTimer.h"
+#elif defined(ARDUINO_ARCH_MBED)
+    #include <mbed.h>
+#endif
+
+// ============================================
+// Hardware Timer Backends
+// ============================================
+
+// The engine that the timer interrupt steps (one status LED per device)
+static DFPongStatusLED* timerLed = nullptr;
+
+#if defined(DFPONG_NO_LED_TIMER)
+
+static bool startLedTimer() {
+    return false;  // Opted out - step from update()
+}
+
+#elif defined(ESP32)
+
+static esp_timer_handle_t ledTimer = nullptr;
+
+static void onLedTimer(void* arg) {
+    if (timerLed != nullptr) timerLed->tick();
+}
+
+static bool startLedTimer() {
+    esp_timer_create_args_t args = {};
+    args.callback = onLedTimer;
+    args.name = "dfpong_led";
+    if (esp_timer_create(&args, &ledTimer) != ESP_OK) return false;
+    return esp_timer_start_periodic(ledTimer, DFPongStatusLED::TICK_MS * 1000) == ESP_OK;
+}
+
+#elif defined(ARDUINO_ARCH_SAMD)
+
+// Defined by DFPongTC3Timer.h when the sketch includes it. The TC3
+// interrupt handler lives there too, so sketches that leave it out
+// keep TC3 for themselves.
+extern bool dfpongStartLedTimerTC3() __attribute__((weak));
+
+static bool startLedTimer() {
+    if (dfpongStartLedTimerTC3 == nullptr) return false;  // Step from update()
+    return dfpongStartLedTimerTC3();
+}
+
+#elif defined(ARDUINO_ARCH_RENESAS)
+
+static FspTimer ledTimer;
+
+static void onLedTimer(timer_callback_args_t* args) {
+    if (timerLed != nullptr) timerLed->tick();
+}
+
+static bool startLedTimer() {
+    uint8_t type;
+    int8_t channel = FspTimer::get_available_timer(type);
+    if (channel < 0) return false;
+
+    if (!ledTimer.begin(TIMER_MODE_PERIODIC, type, channel,
+                        1000.0f / DFPongStatusLED::TICK_MS, 0.0f, onLedTimer)) {
+        return false;
+    }
+    return ledTimer.setup_overflow_irq() && ledTimer.open() && ledTimer.start();
+}
+
+#elif defined(ARDUINO_ARCH_MBED)
+
+static mbed::Ticker ledTimer;
+
+static void onLedTimer() {
+    if (timerLed != nullptr) timerLed->tick();
+}
+
+static bool startLedTimer() {
+    ledTimer.attach(mbed::callback(onLedTimer), std::chrono::milliseconds(DFPongStatusLED::TICK_MS));
+    return true;
+}
+
+#else
+
+static bool startLedTimer() {
+    return false;  // No timer backend - step from update()
+}
+
+#endif
+
+#if defined(ARDUINO_ARCH_SAMD)
+// Called from TC3_Handler() in DFPongTC3Timer.h
+void dfpongLedTimerTick() {
+    if (timerLed != nullptr) timerLed->tick();
+}
+#endif
+
+// ============================================
+// Setup
+// ============================================
+
+DFPongStatusLED::DFPongStatusLED() {
+    _pin = -1;
+    _hardwareTimer = false;
+    _lastPoll = 0;
+    _pattern = 0;
+    _activePattern = 0xFFFFFFFF;  // Forces the first tick() to apply
+    _step = 0;
+    _ticks = 0;
+    _level = LOW;
+}
+
+bool DFPongStatusLED::begin(int pin) {
+    _pin = pin;
+    pinMode(_pin, OUTPUT);
+    digitalWrite(_pin, LOW);
+    _level = LOW;
+    _lastPoll = millis();
+
+    if (!_hardwareTimer) {
+        timerLed = this;
+        _hardwareTimer = startLedTimer();
+        if (!_hardwareTimer) timerLed = nullptr;
+    }
+    return _hardwareTimer;
+}
+
+bool DFPongStatusLED::usesHardwareTimer() {
+    return _hardwareTimer;
+}
+
+// ============================================
+// Patterns
+// ============================================
+
+void DFPongStatusLED::off() {
+    post(0x0000, 1, TICK_MS);
+}
+
+void DFPongStatusLED::solid() {
+    post(0x0001, 1, TICK_MS);
+}
+
+void DFPongStatusLED::blink(unsigned long periodMs) {
+    post(0x0001, 2, periodMs);  // on, off
+}
+
+void DFPongStatusLED::signal(int bars) {
+    if (bars < 1) bars = 1;
+    if (bars > 4) bars = 4;
+
+    // One 150ms flash per bar, rest of the 16 steps off
+    uint16_t levels = 0;
+    for (int i = 0; i < bars; i++) {
+        levels |= (uint16_t)(1 << (i * 2));
+    }
+    post(levels, 16, 150);
+}
+
+void DFPongStatusLED::error() {
+    post(0x0015, 10, 100);  // on-off x3, then 400ms off
+}
+
+void DFPongStatusLED::post(uint16_t levels, int steps, unsigned long stepMs) {
+    unsigned long stepTicks = stepMs / TICK_MS;
+    if (stepTicks < 1) stepTicks = 1;
+    if (stepTicks > 0xFFF) stepTicks = 0xFFF;
+
+    // A single 32-bit store - the timer sees the old or the new pattern
+    _pattern = (uint32_t)levels |
+               (((uint32_t)(steps - 1) & 0xF) << 16) |
+               ((uint32_t)stepTicks << 20);
+}
+
+// ============================================
+// Stepping
+// ============================================
+
+void DFPongStatusLED::poll(unsigned long nowMs) {
+    if (_pin < 0 || _hardwareTimer) return;
+
+    unsigned long elapsed = nowMs - _lastPoll;
+    if (elapsed > 100 * TICK_MS) {
+        // Too far behind (or clock jumped) - resync instead of catching up
+        _lastPoll = nowMs;
+        tick();
+        return;
+    }
+
+    while (nowMs - _lastPoll >= TICK_MS) {
+        _lastPoll += TICK_MS;
+        tick();
+    }
+}
+
+void DFPongStatusLED::tick() {
+    if (_pin < 0) return;
+
+    uint32_t pattern = _pattern;
+    uint8_t steps = ((pattern >> 16) & 0xF) + 1;
+    uint16_t stepTicks = pattern >> 20;
+
+    if (pattern != _activePattern) {
+        // New pattern - start from its first step
+        _activePattern = pattern;
+        _step = 0;
+        _ticks = 0;
+    } else if (++_ticks >= stepTicks) {
+        _ticks = 0;
+        _step = (_step + 1) % steps;
+    }
+
+    writeLevel((pattern >> _step) & 1 ? HIGH : LOW);
+}
+
+void DFPongStatusLED::writeLevel(int level) {
+    if (level == _level) return;
+    _level = level;
+    digitalWrite(_pin, level);
+}
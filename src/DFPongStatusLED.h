@@ -0,0 +1,120 @@
+/*
+ * DFPongStatusLED.h
+ *
+ * Status LED pattern engine used by DFPongController.
+ * Patterns are stepped by a hardware timer so blinking stays
+ * steady no matter how slow loop() is:
+ * - ESP32: esp_timer
+ * - Nano 33 IoT (SAMD21): TC3, only if the sketch includes
+ *   DFPongTC3Timer.h
+ * - UNO R4 WiFi (RA4M1): FspTimer (GPT/AGT)
+ * - Nano 33 BLE (mbed): Ticker
+ * Other boards fall back to stepping the pattern from update().
+ *
+ * Define DFPONG_NO_LED_TIMER (e.g. as a build flag) to leave all
+ * hardware timers alone.
+ *
+ * Created by Digital Futures OCAD U
+ * MIT License
+ */
+
+#ifndef DF_PONG_STATUS_LED_H
+#define DF_PONG_STATUS_LED_H
+
+#include <Arduino.h>
+
+class DFPongStatusLED {
+public:
+    // Time per timer tick
+    static const unsigned long TICK_MS = 10;
+
+    DFPongStatusLED();
+
+    /**
+     * Configure the LED pin and start the hardware timer.
+     *
+     * @param pin The LED pin
+     * @return true if a hardware timer drives the LED,
+     *         false if poll() has to be called instead
+     */
+    bool begin(int pin);
+
+    /**
+     * Check if a hardware timer drives the LED.
+     *
+     * @return true if poll() is not needed
+     */
+    bool usesHardwareTimer();
+
+    // ----------------------------------------
+    // Patterns - only post a change, cheap to call every loop
+    // ----------------------------------------
+
+    void off();
+    void solid();
+
+    /**
+     * Blink with equal on/off time.
+     *
+     * @param periodMs Time the LED stays on (and off)
+     */
+    void blink(unsigned long periodMs);
+
+    /**
+     * Show signal strength as 1-4 short flashes, then a pause.
+     *
+     * @param bars Number of flashes (1-4)
+     */
+    void signal(int bars);
+
+    /**
+     * Three quick flashes, then a pause.
+     */
+    void error();
+
+    // ----------------------------------------
+    // Stepping
+    // ----------------------------------------
+
+    /**
+     * Step the pattern from the main loop when there is no
+     * hardware timer.
+     *
+     * @param nowMs Current time in ms
+     */
+    void poll(unsigned long nowMs);
+
+    /**
+     * Advance the pattern by one TICK_MS.
+     * Called from the timer interrupt (or a simulated timer).
+     */
+    void tick();
+
+private:
+    int _pin;
+    bool _hardwareTimer;
+    unsigned long _lastPoll;
+
+    // Posted pattern, packed in one word so it can be swapped
+    // safely while the timer interrupt reads it:
+    //   bits 0-15  LED level per step (bit 0 = first step)
+    //   bits 16-19 number of steps - 1
+    //   bits 20-31 ticks per step
+    volatile uint32_t _pattern;
+
+    // Owned by tick()
+    uint32_t _activePattern;
+    uint8_t _step;
+    uint16_t _ticks;
+    int _level;
+
+    void post(uint16_t levels, int steps, unsigned long stepMs);
+    void writeLevel(int level);
+};
+
+#if defined(ARDUINO_ARCH_SAMD)
+// Steps the status LED from the TC3 interrupt (see DFPongTC3Timer.h)
+void dfpongLedTimerTick();
+#endif
+
+#endif // DF_PONG_STATUS_LED_H
@@ -0,0 +1,56 @@
+/*
+ * DFPongTC3Timer.h
+ *
+ * Lets the TC3 timer of a Nano 33 IoT (SAMD21) step the status LED,
+ * so it keeps blinking steadily while loop() is slow.
+ *
+ * Include it in the sketch, once, after DFPongController.h:
+ *
+ *   #include <DFPongController.h>
+ *   #include <DFPongTC3Timer.h>
+ *
+ * It defines the TC3 interrupt handler, so leave it out when the
+ * sketch or another library uses TC3. Without it the pattern is
+ * stepped from update(). Other boards ignore this file.
+ *
+ * Created by Digital Futures OCAD U
+ * MIT License
+ */
+
+#ifndef DF_PONG_TC3_TIMER_H
+#define DF_PONG_TC3_TIMER_H
+
+#if defined(ARDUINO_ARCH_SAMD)
+
+#include "DFPongStatusLED.h"
+
+void TC3_Handler() {
+    TC3->COUNT16.INTFLAG.reg = TC_INTFLAG_MC0;
+    dfpongLedTimerTick();
+}
+
+// Called by DFPongStatusLED::begin()
+bool dfpongStartLedTimerTC3() {
+    // Clock TC3 from the 48 MHz GCLK0
+    GCLK->CLKCTRL.reg = GCLK_CLKCTRL_CLKEN | GCLK_CLKCTRL_GEN_GCLK0 | GCLK_CLKCTRL_ID_TCC2_TC3;
+    while (GCLK->STATUS.bit.SYNCBUSY);
+
+    TC3->COUNT16.CTRLA.reg &= ~TC_CTRLA_ENABLE;
+    while (TC3->COUNT16.STATUS.bit.SYNCBUSY);
+
+    // Match frequency mode: 48 MHz / 1024 counts to one tick
+    TC3->COUNT16.CTRLA.reg = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_WAVEGEN_MFRQ | TC_CTRLA_PRESCALER_DIV1024;
+    TC3->COUNT16.CC[0].reg = (uint16_t)(48000000UL / 1024 * DFPongStatusLED::TICK_MS / 1000 - 1);
+    while (TC3->COUNT16.STATUS.bit.SYNCBUSY);
+
+    TC3->COUNT16.INTENSET.reg = TC_INTENSET_MC0;
+    NVIC_EnableIRQ(TC3_IRQn);
+
+    TC3->COUNT16.CTRLA.reg |= TC_CTRLA_ENABLE;
+    while (TC3->COUNT16.STATUS.bit.SYNCBUSY);
+    return true;
+}
+
+#endif
+
+#endif // DF_PONG_TC3_TIMER_H